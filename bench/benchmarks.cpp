@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/suggestion.hpp"
+#include "../include/searchworker.hpp"
+#include "../include/pathscanner.hpp"
+#include "../include/ui.hpp"
+#include "trie.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    // Every allocation through operator new in the whole process, to check
+    // that typing does none once warm
+    std::atomic<uint64_t> g_allocations(0);
+}
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size ? size : 1))
+    {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+    std::free(block);
+}
+
+namespace
+{
+    // Deterministic names shaped like real executables: a few syllables,
+    // sometimes a separator or a version digit. The same seed always yields
+    // the same corpus, so results stay comparable between runs.
+    std::vector<std::string> makeNames(size_t count)
+    {
+        static const char* kSyllables[] = { "fi", "re", "fox", "chro", "mi", "um", "gi", "t", "py", "th", "on",
+                                            "x", "term", "ls", "blk", "id", "sys", "ctl", "net", "work", "man",
+                                            "ger", "pa", "cat", "ed", "it", "or", "conf", "dump", "ssh", "keys" };
+        static const char  kSeparators[] = { '-', '_', '.' };
+
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        auto next = [&state]
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        };
+
+        std::unordered_set<std::string> seen;
+        std::vector<std::string> names;
+        names.reserve(count);
+
+        while (names.size() < count)
+        {
+            std::string name;
+            size_t syllables = 2 + next() % 4;
+            for (size_t i = 0; i < syllables; ++i)
+            {
+                if (i > 0 && next() % 6 == 0)
+                {
+                    name += kSeparators[next() % 3];
+                }
+                name += kSyllables[next() % (sizeof(kSyllables) / sizeof(kSyllables[0]))];
+            }
+
+            if (next() % 5 == 0)
+            {
+                name += static_cast<char>('0' + next() % 10);
+            }
+
+            if (seen.insert(name).second)
+            {
+                names.push_back(name);
+            }
+        }
+
+        return names;
+    }
+
+    // A fake $PATH of directories holding up to kPerDirectory empty
+    // executables each. Built once per size and removed at exit, since
+    // creating 100k files would otherwise dominate the run.
+    class SyntheticPath final
+    {
+    public:
+        static constexpr size_t kPerDirectory = 2000;
+
+        static const std::vector<std::string>& directories(size_t executables)
+        {
+            static std::map<size_t, std::unique_ptr<SyntheticPath>> trees;
+
+            std::unique_ptr<SyntheticPath>& tree = trees[executables];
+            if (!tree)
+            {
+                tree.reset(new SyntheticPath(executables));
+            }
+            return tree->m_directories;
+        }
+
+        ~SyntheticPath()
+        {
+            if (!m_root.empty())
+            {
+                std::error_code ec;
+                fs::remove_all(m_root, ec);
+            }
+        }
+    private:
+        explicit SyntheticPath(size_t executables)
+        {
+            std::string pattern = (fs::temp_directory_path() / "rex-bench-XXXXXX").string();
+            if (!mkdtemp(pattern.data()))
+            {
+                throw std::runtime_error("Failed to create a temporary directory.");
+            }
+            m_root = pattern;
+
+            std::vector<std::string> names = makeNames(executables);
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                if (i % kPerDirectory == 0)
+                {
+                    m_directories.push_back(m_root + "/bin" + std::to_string(m_directories.size()));
+                    fs::create_directory(m_directories.back());
+                }
+
+                std::string file = m_directories.back() + "/" + names[i];
+                int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0755);
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+        std::string              m_root;
+        std::vector<std::string> m_directories;
+    };
+
+    Suggestions& corpus(size_t size)
+    {
+        static std::map<size_t, std::unique_ptr<Suggestions>> corpora;
+
+        std::unique_ptr<Suggestions>& suggestions = corpora[size];
+        if (!suggestions)
+        {
+            suggestions = std::make_unique<Suggestions>();
+            for (const auto& name : makeNames(size))
+            {
+                suggestions->add_word(name);
+            }
+        }
+        return *suggestions;
+    }
+
+    // Reports the allocations since `start` per iteration, and fails the
+    // benchmark if there were any: the path measured is meant to have none.
+    void requireNoAllocations(benchmark::State& state, uint64_t start)
+    {
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed) - start;
+        state.counters["allocations"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+        if (allocations > 0)
+        {
+            state.SkipWithError("the query path allocated after warming up");
+        }
+    }
+}
+
+static void BM_TrieInsert(benchmark::State& state)
+{
+    std::vector<std::string> names = makeNames(state.range(0));
+
+    for (auto _ : state)
+    {
+        Trie trie;
+        for (const auto& name : names)
+        {
+            trie.insert(name);
+        }
+        benchmark::DoNotOptimize(trie.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_TrieInsert)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_TrieGetMatches(benchmark::State& state)
+{
+    Trie trie;
+    for (const auto& name : makeNames(state.range(0)))
+    {
+        trie.insert(name);
+    }
+
+    // Short prefixes have the largest subtrees
+    const std::string prefixes[] = { "f", "ch", "sys", "pyth" };
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(trie.get_matches(prefixes[i++ % 4], 6));
+    }
+}
+BENCHMARK(BM_TrieGetMatches)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// One query from scratch: the two queries share no prefix, so neither can
+// resume from the matcher's cached levels.
+static void BM_BestMatchesCold(benchmark::State& state)
+{
+    Suggestions& suggestions = corpus(state.range(0));
+    const std::string queries[] = { "fox", "ctl" };
+    uint32_t ids[6];
+    size_t count = 0;
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        suggestions.get_best_matches(queries[i++ % 2], suggestions.search_generation(), ids, 6, count);
+        benchmark::DoNotOptimize(count);
+    }
+}
+BENCHMARK(BM_BestMatchesCold)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// A query typed one character at a time, as the launcher sees it. Once both
+// queries have run, this must not allocate.
+static void BM_BestMatchesTyped(benchmark::State& state)
+{
+    Suggestions& suggestions = corpus(state.range(0));
+    const std::string_view queries[] = { "firefox", "sysctl" };
+    uint32_t ids[6];
+    size_t count = 0;
+
+    auto type = [&](std::string_view query)
+    {
+        for (size_t length = 1; length <= query.size(); ++length)
+        {
+            suggestions.get_best_matches(query.substr(0, length), suggestions.search_generation(), ids, 6, count);
+            benchmark::DoNotOptimize(count);
+        }
+    };
+
+    type(queries[0]);
+    type(queries[1]);
+
+    uint64_t start = g_allocations.load(std::memory_order_relaxed);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        type(queries[i++ % 2]);
+    }
+    requireNoAllocations(state, start);
+}
+BENCHMARK(BM_BestMatchesTyped)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// The same through the search worker, as the event loop drives it: queue
+// the search, wait for its ids and read their names.
+static void BM_WorkerTyped(benchmark::State& state)
+{
+    Suggestions& suggestions = corpus(state.range(0));
+    SearchWorker worker(suggestions);
+    if (!worker.start())
+    {
+        state.SkipWithError("failed to start the search worker");
+        return;
+    }
+
+    const std::string_view queries[] = { "firefox", "sysctl" };
+    std::vector<uint32_t> ids;
+    size_t bytes = 0;
+
+    auto type = [&](std::string_view query)
+    {
+        for (size_t length = 1; length <= query.size(); ++length)
+        {
+            worker.search(query.substr(0, length), 6);
+            worker.waitForResults(ids);
+
+            std::shared_lock<std::shared_mutex> lock = suggestions.read_lock();
+            for (uint32_t id : ids)
+            {
+                bytes += suggestions.name(id).size();
+            }
+        }
+    };
+
+    // Every queue slot has to have held the longest query and result once
+    for (size_t warmup = 0; warmup < 64; ++warmup)
+    {
+        type(queries[warmup % 2]);
+    }
+
+    uint64_t start = g_allocations.load(std::memory_order_relaxed);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        type(queries[i++ % 2]);
+    }
+    requireNoAllocations(state, start);
+
+    benchmark::DoNotOptimize(bytes);
+    worker.stop();
+}
+BENCHMARK(BM_WorkerTyped)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_PathScan(benchmark::State& state)
+{
+    const std::vector<std::string>& directories = SyntheticPath::directories(state.range(0));
+
+    for (auto _ : state)
+    {
+        std::vector<std::vector<std::string>> entries;
+        PathScanner::scan(directories, entries);
+        benchmark::DoNotOptimize(entries.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PathScan)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+namespace
+{
+    // The window size init() picks on a 1920x1080 screen
+    constexpr uint16_t kFrameWidth = 326;
+    constexpr uint16_t kFrameHeight = 324;
+
+    void reportLayoutCache(benchmark::State& state, const UI& ui)
+    {
+        state.counters["layout_hit_rate"] = ui.layoutCache().hitRate();
+    }
+
+    // The names the UI benchmarks draw, with their ids
+    std::vector<uint32_t> intern(CandidatePool& names, size_t count)
+    {
+        std::vector<uint32_t> ids;
+        for (const auto& name : makeNames(count))
+        {
+            ids.push_back(names.intern(name));
+        }
+        return ids;
+    }
+}
+
+// A full frame: background, search bar and six rows
+static void BM_UiFullFrame(benchmark::State& state)
+{
+    UI ui;
+    ui.initHeadless(kFrameWidth, kFrameHeight);
+
+    CandidatePool names;
+    std::vector<uint32_t> rows = intern(names, 6);
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        ui.drawUI("fire", rows, names, i++ % rows.size());
+    }
+
+    reportLayoutCache(state, ui);
+}
+BENCHMARK(BM_UiFullFrame)->Unit(benchmark::kMicrosecond);
+
+// Moving the highlight: only the two rows involved are repainted
+static void BM_UiHighlightMove(benchmark::State& state)
+{
+    UI ui;
+    ui.initHeadless(kFrameWidth, kFrameHeight);
+
+    CandidatePool names;
+    std::vector<uint32_t> rows = intern(names, 6);
+    ui.drawUI("fire", rows, names, 0);
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        ui.updateUI("fire", rows, names, ++i % rows.size());
+    }
+
+    reportLayoutCache(state, ui);
+}
+BENCHMARK(BM_UiHighlightMove)->Unit(benchmark::kMicrosecond);
+
+// Typing: the search bar and every row change
+static void BM_UiTyping(benchmark::State& state)
+{
+    UI ui;
+    ui.initHeadless(kFrameWidth, kFrameHeight);
+
+    CandidatePool names;
+    std::vector<uint32_t> ids = intern(names, 64);
+    std::vector<uint32_t> rows;
+    const std::string query = "firefox";
+    size_t i = 0;
+
+    for (auto _ : state)
+    {
+        size_t step = i++;
+        rows.assign(ids.begin() + step % 58, ids.begin() + step % 58 + 6);
+        ui.updateUI(std::string_view(query).substr(0, 1 + step % query.size()), rows, names, 0);
+    }
+
+    reportLayoutCache(state, ui);
+}
+BENCHMARK(BM_UiTyping)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "../include/types.hpp"
+
+// Path-compressed radix trie.
+//
+// All nodes live in one arena (m_nodes) and address their children through a
+// run of edges in m_edges, kept sorted by the first byte of the child's label.
+// Labels are slices of a shared string pool, so splitting an edge never copies
+// bytes. A full edge run is moved to the end of m_edges with twice the room;
+// the abandoned runs, freed nodes and dead label bytes left behind by erase()
+// are only reclaimed when the trie is rebuilt.
+//
+// Every node also knows how many words its subtree holds and keeps the
+// kBestPerNode best of them (shortest first, then earliest inserted) in its
+// slice of m_best, so a limited prefix query is answered from the node the
+// prefix leads to without visiting its subtree.
+//
+// Rex itself matches against the flat CandidatePool; the trie is kept here as
+// the prefix-lookup baseline the benchmarks compare it with.
+struct Trie final
+{
+    static constexpr size_t kBestPerNode = 8;
+
+    struct Node
+    {
+        uint32_t m_label_offset;
+        uint32_t m_label_length;
+        uint32_t m_first_edge;
+        uint16_t m_edge_count;
+        uint16_t m_edge_capacity;
+        uint32_t m_parent;
+        uint32_t m_subtree_words;
+        uint32_t m_sequence;
+        uint16_t m_depth;
+        uint8_t  m_best_count;
+        bool     m_is_end_of_word;
+    };
+
+    struct Edge
+    {
+        uint32_t      m_node;
+        unsigned char m_first;
+    };
+
+    Trie()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        m_nodes.assign(1, Node{});
+        m_edges.clear();
+        m_pool.clear();
+        m_best.assign(kBestPerNode, 0);
+        m_free_nodes.clear();
+        m_size = 0;
+        m_next_sequence = 0;
+    }
+
+    void insert(const std::string& word)
+    {
+        uint32_t node = 0;
+        size_t depth = 0;
+
+        while (depth < word.size())
+        {
+            unsigned char first = word[depth];
+            uint32_t slot;
+            if (!find_edge(node, first, slot))
+            {
+                uint32_t leaf = new_node(static_cast<uint32_t>(m_pool.size()), static_cast<uint32_t>(word.size() - depth));
+                m_pool.append(word, depth, std::string::npos);
+                m_nodes[leaf].m_parent = node;
+                m_nodes[leaf].m_depth = static_cast<uint16_t>(word.size());
+                insert_edge(node, slot, leaf, first);
+                mark_word(leaf);
+                return;
+            }
+
+            uint32_t child = m_edges[slot].m_node;
+            std::string_view child_label = label(child);
+            size_t common = 1;
+            while (common < child_label.size() && depth + common < word.size() && child_label[common] == word[depth + common])
+            {
+                ++common;
+            }
+
+            if (common < child_label.size())
+            {
+                child = split(slot, static_cast<uint32_t>(common));
+            }
+
+            node = child;
+            depth += common;
+        }
+
+        if (!m_nodes[node].m_is_end_of_word)
+        {
+            mark_word(node);
+        }
+    }
+
+    bool contains(const std::string& word) const
+    {
+        uint32_t node;
+        size_t consumed;
+        return walk(word, node, consumed) && consumed == word.size() && m_nodes[node].m_is_end_of_word;
+    }
+
+    void erase(const std::string& word)
+    {
+        // (node, slot of the edge leading to it) from the root down
+        std::vector<std::pair<uint32_t, uint32_t>> path;
+        uint32_t node = 0;
+        size_t depth = 0;
+
+        while (depth < word.size())
+        {
+            uint32_t slot;
+            if (!find_edge(node, static_cast<unsigned char>(word[depth]), slot))
+            {
+                return;
+            }
+
+            uint32_t child = m_edges[slot].m_node;
+            std::string_view child_label = label(child);
+            if (word.compare(depth, child_label.size(), child_label.data(), child_label.size()) != 0)
+            {
+                return;
+            }
+
+            path.emplace_back(child, slot);
+            node = child;
+            depth += child_label.size();
+        }
+
+        if (!m_nodes[node].m_is_end_of_word)
+        {
+            return;
+        }
+
+        uint32_t erased = node;
+        m_nodes[node].m_is_end_of_word = false;
+        --m_size;
+
+        // The deepest node still standing whose subtree held the word
+        uint32_t lowest = node;
+
+        if (path.empty())
+        {
+            // Only the root spells the empty word
+        }
+        else if (m_nodes[node].m_edge_count == 0)
+        {
+            uint32_t parent = m_nodes[node].m_parent;
+            remove_edge(parent, path.back().second);
+            free_node(node);
+            path.pop_back();
+            lowest = parent;
+
+            if (!path.empty() && !m_nodes[parent].m_is_end_of_word && m_nodes[parent].m_edge_count == 1)
+            {
+                lowest = m_nodes[parent].m_parent;
+                merge_with_child(path.back().second);
+            }
+        }
+        else if (m_nodes[node].m_edge_count == 1)
+        {
+            lowest = m_nodes[node].m_parent;
+            merge_with_child(path.back().second);
+        }
+
+        unmark_word(lowest, erased);
+    }
+
+    // The `limit` best words starting with `prefix`, shortest first. Up to
+    // kBestPerNode of them come straight from the node the prefix leads to;
+    // only a larger limit walks the subtree.
+    std::vector<std::string> get_matches(const std::string& prefix, size_t limit = std::numeric_limits<size_t>::max()) const
+    {
+        std::vector<std::string> matches;
+
+        uint32_t node;
+        size_t consumed;
+        if (limit == 0 || !walk(prefix, node, consumed))
+        {
+            return matches;
+        }
+
+        const Node& n = m_nodes[node];
+        if (limit <= n.m_best_count || n.m_best_count == n.m_subtree_words)
+        {
+            const uint32_t* best = &m_best[node * kBestPerNode];
+            size_t count = std::min<size_t>(limit, n.m_best_count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                matches.push_back(word_at(best[i]));
+            }
+            return matches;
+        }
+
+        std::vector<uint32_t> words;
+        words.reserve(n.m_subtree_words);
+        collect_words(node, words);
+
+        size_t count = std::min(limit, words.size());
+        std::partial_sort(words.begin(), words.begin() + count, words.end(),
+                          [this](uint32_t a, uint32_t b)
+                          {
+                              return ranks_before(a, b);
+                          });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            matches.push_back(word_at(words[i]));
+        }
+        return matches;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    size_t memory_bytes() const
+    {
+        return m_nodes.capacity() * sizeof(Node) + m_edges.capacity() * sizeof(Edge) + m_pool.capacity() +
+               m_best.capacity() * sizeof(uint32_t) + m_free_nodes.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    std::string_view label(uint32_t node) const
+    {
+        return std::string_view(m_pool.data() + m_nodes[node].m_label_offset, m_nodes[node].m_label_length);
+    }
+
+    // Descends as far as `key` reaches. On success `node` is the first node
+    // whose path covers the whole key and `consumed` is that path's length.
+    bool walk(const std::string& key, uint32_t& node, size_t& consumed) const
+    {
+        node = 0;
+        consumed = 0;
+
+        while (consumed < key.size())
+        {
+            uint32_t slot;
+            if (!find_edge(node, static_cast<unsigned char>(key[consumed]), slot))
+            {
+                return false;
+            }
+
+            node = m_edges[slot].m_node;
+            std::string_view node_label = label(node);
+            size_t length = std::min(node_label.size(), key.size() - consumed);
+            if (key.compare(consumed, length, node_label.data(), length) != 0)
+            {
+                return false;
+            }
+
+            consumed += node_label.size();
+        }
+
+        return true;
+    }
+
+    // Binary search in the sorted edge run of `node`. `slot` is the edge's
+    // index in m_edges, or where it would have to be inserted.
+    bool find_edge(uint32_t node, unsigned char first, uint32_t& slot) const
+    {
+        const Node& n = m_nodes[node];
+        uint32_t low = n.m_first_edge;
+        uint32_t high = n.m_first_edge + n.m_edge_count;
+
+        while (low < high)
+        {
+            uint32_t mid = (low + high) / 2;
+            if (m_edges[mid].m_first < first)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        slot = low;
+        return low < n.m_first_edge + n.m_edge_count && m_edges[low].m_first == first;
+    }
+
+    void insert_edge(uint32_t node, uint32_t slot, uint32_t child, unsigned char first)
+    {
+        Node& n = m_nodes[node];
+        if (n.m_edge_count == n.m_edge_capacity)
+        {
+            uint32_t old_first = n.m_first_edge;
+            uint32_t new_first = static_cast<uint32_t>(m_edges.size());
+            uint16_t capacity = n.m_edge_capacity ? static_cast<uint16_t>(n.m_edge_capacity * 2) : 2;
+
+            m_edges.resize(m_edges.size() + capacity);
+            std::copy(m_edges.begin() + old_first, m_edges.begin() + old_first + n.m_edge_count, m_edges.begin() + new_first);
+
+            slot = slot - old_first + new_first;
+            n.m_first_edge = new_first;
+            n.m_edge_capacity = capacity;
+        }
+
+        uint32_t end = n.m_first_edge + n.m_edge_count;
+        std::copy_backward(m_edges.begin() + slot, m_edges.begin() + end, m_edges.begin() + end + 1);
+        m_edges[slot] = Edge{ child, first };
+        ++n.m_edge_count;
+    }
+
+    void remove_edge(uint32_t node, uint32_t slot)
+    {
+        Node& n = m_nodes[node];
+        uint32_t end = n.m_first_edge + n.m_edge_count;
+        std::copy(m_edges.begin() + slot + 1, m_edges.begin() + end, m_edges.begin() + slot);
+        --n.m_edge_count;
+    }
+
+    // Cuts the label of the child at `slot` after `length` bytes; the head
+    // becomes a new inner node in the child's place. Returns the head.
+    uint32_t split(uint32_t slot, uint32_t length)
+    {
+        uint32_t child = m_edges[slot].m_node;
+        uint32_t head = new_node(m_nodes[child].m_label_offset, length);
+
+        // The head spans exactly the child's subtree
+        Node& h = m_nodes[head];
+        Node& c = m_nodes[child];
+        h.m_parent = c.m_parent;
+        h.m_depth = static_cast<uint16_t>(c.m_depth - (c.m_label_length - length));
+        h.m_subtree_words = c.m_subtree_words;
+        h.m_best_count = c.m_best_count;
+        std::copy_n(m_best.begin() + child * kBestPerNode, kBestPerNode, m_best.begin() + head * kBestPerNode);
+
+        c.m_parent = head;
+        c.m_label_offset += length;
+        c.m_label_length -= length;
+
+        insert_edge(head, m_nodes[head].m_first_edge, child, static_cast<unsigned char>(label(child)[0]));
+        m_edges[slot].m_node = head;
+        return head;
+    }
+
+    // Folds the single child of the node at `slot` into it, keeping the trie
+    // path-compressed after an erase.
+    void merge_with_child(uint32_t slot)
+    {
+        uint32_t node = m_edges[slot].m_node;
+        uint32_t child = m_edges[m_nodes[node].m_first_edge].m_node;
+        Node& n = m_nodes[node];
+        Node& c = m_nodes[child];
+
+        if (n.m_label_offset + n.m_label_length == c.m_label_offset)
+        {
+            c.m_label_offset = n.m_label_offset;
+        }
+        else
+        {
+            std::string joined(label(node));
+            joined.append(label(child));
+            c.m_label_offset = static_cast<uint32_t>(m_pool.size());
+            m_pool += joined;
+        }
+        c.m_label_length += n.m_label_length;
+        c.m_parent = n.m_parent;
+
+        m_edges[slot].m_node = child;
+        free_node(node);
+    }
+
+    uint32_t new_node(uint32_t label_offset, uint32_t label_length)
+    {
+        Node node = {};
+        node.m_label_offset = label_offset;
+        node.m_label_length = label_length;
+
+        if (!m_free_nodes.empty())
+        {
+            uint32_t index = m_free_nodes.back();
+            m_free_nodes.pop_back();
+            m_nodes[index] = node;
+            return index;
+        }
+
+        m_nodes.push_back(node);
+        m_best.resize(m_nodes.size() * kBestPerNode);
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void free_node(uint32_t node)
+    {
+        m_nodes[node] = Node{};
+        m_free_nodes.push_back(node);
+    }
+
+    // Shorter words first, then the order they were inserted in
+    bool ranks_before(uint32_t a, uint32_t b) const
+    {
+        if (m_nodes[a].m_depth != m_nodes[b].m_depth)
+        {
+            return m_nodes[a].m_depth < m_nodes[b].m_depth;
+        }
+
+        return m_nodes[a].m_sequence < m_nodes[b].m_sequence;
+    }
+
+    // Inserts `word` into the best list of `node` if it ranks high enough.
+    // Returns false if it did not make the cut.
+    bool offer_best(uint32_t node, uint32_t word)
+    {
+        uint32_t* best = &m_best[node * kBestPerNode];
+        uint8_t& count = m_nodes[node].m_best_count;
+
+        size_t position = count;
+        while (position > 0 && ranks_before(word, best[position - 1]))
+        {
+            --position;
+        }
+
+        if (position == kBestPerNode)
+        {
+            return false;
+        }
+
+        size_t end = std::min<size_t>(count, kBestPerNode - 1);
+        std::copy_backward(best + position, best + end, best + end + 1);
+        best[position] = word;
+        count = static_cast<uint8_t>(end + 1);
+        return true;
+    }
+
+    // Rebuilds the best list of `node` from its own word and its children's
+    // lists; the best of a subtree are always among the best of its parts.
+    void rebuild_best(uint32_t node)
+    {
+        const Node& n = m_nodes[node];
+        m_nodes[node].m_best_count = 0;
+
+        if (n.m_is_end_of_word)
+        {
+            offer_best(node, node);
+        }
+
+        for (uint32_t slot = n.m_first_edge; slot < n.m_first_edge + n.m_edge_count; ++slot)
+        {
+            uint32_t child = m_edges[slot].m_node;
+            const uint32_t* best = &m_best[child * kBestPerNode];
+            for (uint8_t i = 0; i < m_nodes[child].m_best_count && offer_best(node, best[i]); ++i)
+            {
+            }
+        }
+    }
+
+    // Marks `node` as a word and accounts for it on the way up to the root.
+    // Once it misses a node's best list it cannot make any ancestor's either.
+    void mark_word(uint32_t node)
+    {
+        m_nodes[node].m_is_end_of_word = true;
+        m_nodes[node].m_sequence = m_next_sequence++;
+        ++m_size;
+
+        bool ranked = true;
+        for (uint32_t current = node; ; current = m_nodes[current].m_parent)
+        {
+            ++m_nodes[current].m_subtree_words;
+            ranked = ranked && offer_best(current, node);
+            if (current == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    // Takes the erased `word` out of the counts and best lists from `node`
+    // up. Above the first list that did not hold it, no list does.
+    void unmark_word(uint32_t node, uint32_t word)
+    {
+        bool listed = true;
+        for (uint32_t current = node; ; current = m_nodes[current].m_parent)
+        {
+            --m_nodes[current].m_subtree_words;
+            if (listed)
+            {
+                const uint32_t* best = &m_best[current * kBestPerNode];
+                listed = std::find(best, best + m_nodes[current].m_best_count, word) != best + m_nodes[current].m_best_count;
+                if (listed)
+                {
+                    rebuild_best(current);
+                }
+            }
+
+            if (current == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    // Spells out the word ending at `node` by following parent links.
+    std::string word_at(uint32_t node) const
+    {
+        std::string word(m_nodes[node].m_depth, '\0');
+        size_t end = word.size();
+
+        for (uint32_t current = node; current != 0; current = m_nodes[current].m_parent)
+        {
+            std::string_view node_label = label(current);
+            end -= node_label.size();
+            std::copy(node_label.begin(), node_label.end(), word.begin() + end);
+        }
+
+        return word;
+    }
+
+    void collect_words(uint32_t node, std::vector<uint32_t>& words) const
+    {
+        if (m_nodes[node].m_is_end_of_word)
+        {
+            words.push_back(node);
+        }
+
+        const Node& n = m_nodes[node];
+        for (uint32_t slot = n.m_first_edge; slot < n.m_first_edge + n.m_edge_count; ++slot)
+        {
+            collect_words(m_edges[slot].m_node, words);
+        }
+    }
+
+private:
+    std::vector<Node>     m_nodes;
+    std::vector<Edge>     m_edges;
+    std::string           m_pool;
+    std::vector<uint32_t> m_best;
+    std::vector<uint32_t> m_free_nodes;
+    size_t                m_size;
+    uint32_t              m_next_sequence;
+};
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Every candidate name packed back to back in one buffer, followed by
+// kPadding bytes so that a full vector load starting anywhere inside a name
+// stays in bounds. Matching scans this buffer front to back instead of chasing
+// one heap allocation per std::string.
+//
+// A name keeps its 32-bit id for the lifetime of the pool. Removing one only
+// takes it out of matching, and interning the same name again brings back its
+// old id, so ids can be held on to and compared instead of the names. The
+// bytes of removed names stay until the pool is cleared.
+class CandidatePool final
+{
+public:
+    static constexpr size_t kPadding = 32;
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    CandidatePool() : m_interned(0)
+    {
+        clear();
+    }
+
+    void clear();
+
+    // Appends `word` under the next id, whether or not it is already there
+    uint32_t add(std::string_view word);
+
+    // The id of `word`, added first unless it is already in the pool
+    uint32_t intern(std::string_view word);
+
+    // The id `word` was interned under, removed or not, or kNone. Words only
+    // add()ed are not found.
+    uint32_t find(std::string_view word) const;
+
+    // Takes a word out of matching, or puts it back. Its id and bytes stay.
+    void remove(uint32_t id);
+    void restore(uint32_t id);
+
+    bool removed(uint32_t id) const
+    {
+        return m_lengths[id] == 0;
+    }
+
+    // The word, also once removed
+    std::string_view get(uint32_t id) const
+    {
+        return std::string_view(m_bytes.data() + m_offsets[id], extent(id));
+    }
+
+    // How much of the word matching looks at: 0 once removed
+    uint16_t length(uint32_t id) const
+    {
+        return m_lengths[id];
+    }
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(m_offsets.size());
+    }
+
+    // Keeps the candidates in which `ch` occurs at or after their resume
+    // offset, together with the offset just past that occurrence. With
+    // `candidates` null, the ids `first` to `first + count` are tried from
+    // offset 0 instead.
+    void narrow(char ch, const uint32_t* candidates, const uint16_t* resume, uint32_t first, size_t count,
+                std::vector<uint32_t>& out_candidates, std::vector<uint16_t>& out_resume) const;
+
+    // Picks the matching kernel; the default is the best the CPU supports.
+    static bool selectKernel(Kernel kernel);
+    static Kernel activeKernel();
+    static const char* kernelName(Kernel kernel);
+private:
+    // Words are stored back to back, so each one ends where the next begins
+    uint32_t extent(uint32_t id) const
+    {
+        uint32_t end = id + 1 < size() ? m_offsets[id + 1] : static_cast<uint32_t>(m_bytes.size() - kPadding);
+        return end - m_offsets[id];
+    }
+
+    void grow_index();
+private:
+    std::vector<char>      m_bytes;
+    std::vector<uint32_t>  m_offsets;
+    std::vector<uint16_t>  m_lengths;
+
+    // Open addressing over the interned words: id + 1 per slot, 0 if empty.
+    // Kept at most half full.
+    std::vector<uint32_t>  m_index;
+    uint32_t               m_interned;
+};
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Simple case folding that never changes the length of a string, so every
+// byte offset into a folded name is also valid in the original.
+//
+// ASCII takes a branch-free path. Two-byte UTF-8 sequences are folded through
+// a table covering Latin-1, Latin Extended-A, Greek, Cyrillic and Armenian.
+// Characters whose lowercase form is encoded in a different number of bytes
+// (e.g. U+0130) and everything beyond U+07FF are left as they are, as are
+// malformed sequences.
+struct CaseFold final
+{
+    static void fold(std::string_view text, std::string& out)
+    {
+        out.resize(text.size());
+
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c < 0x80)
+            {
+                out[i] = static_cast<char>(c + (is_upper(c) ? 0x20 : 0));
+                continue;
+            }
+
+            // A two-byte sequence: 110xxxxx 10xxxxxx
+            unsigned char next = i + 1 < text.size() ? static_cast<unsigned char>(text[i + 1]) : 0;
+            if ((c & 0xE0) == 0xC0 && (next & 0xC0) == 0x80)
+            {
+                uint16_t folded = table()[((c & 0x1F) << 6) | (next & 0x3F)];
+                out[i] = static_cast<char>(0xC0 | (folded >> 6));
+                out[i + 1] = static_cast<char>(0x80 | (folded & 0x3F));
+                ++i;
+                continue;
+            }
+
+            out[i] = text[i];
+        }
+    }
+
+    static std::string fold(std::string_view text)
+    {
+        std::string out;
+        fold(text, out);
+        return out;
+    }
+
+    // True if folding would change nothing, i.e. `text` has no uppercase
+    static bool is_folded(std::string_view text)
+    {
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c < 0x80)
+            {
+                if (is_upper(c))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            unsigned char next = i + 1 < text.size() ? static_cast<unsigned char>(text[i + 1]) : 0;
+            if ((c & 0xE0) == 0xC0 && (next & 0xC0) == 0x80)
+            {
+                uint16_t code = ((c & 0x1F) << 6) | (next & 0x3F);
+                if (table()[code] != code)
+                {
+                    return false;
+                }
+                ++i;
+            }
+        }
+        return true;
+    }
+
+private:
+    static bool is_upper(unsigned char c)
+    {
+        return c >= 'A' && c <= 'Z';
+    }
+
+    // Lowercase of every code point below U+0800
+    static const std::array<uint16_t, 0x800>& table()
+    {
+        static const std::array<uint16_t, 0x800> lower = build_table();
+        return lower;
+    }
+
+    static std::array<uint16_t, 0x800> build_table()
+    {
+        std::array<uint16_t, 0x800> lower;
+        for (uint16_t code = 0; code < lower.size(); ++code)
+        {
+            lower[code] = code;
+        }
+
+        auto shift = [&lower](uint16_t first, uint16_t last, int offset)
+        {
+            for (uint16_t code = first; code <= last; ++code)
+            {
+                lower[code] = static_cast<uint16_t>(code + offset);
+            }
+        };
+
+        // Upper and lower case alternate, the uppercase one at even or at
+        // odd code points
+        auto pairs = [&lower](uint16_t first, uint16_t last)
+        {
+            for (uint16_t code = first; code < last; code += 2)
+            {
+                lower[code] = code + 1;
+            }
+        };
+
+        // Latin-1 Supplement, except U+00D7 MULTIPLICATION SIGN
+        shift(0x00C0, 0x00DE, 0x20);
+        lower[0x00D7] = 0x00D7;
+
+        // Latin Extended-A
+        pairs(0x0100, 0x012F);
+        pairs(0x0132, 0x0137);
+        pairs(0x0139, 0x0148);
+        pairs(0x014A, 0x0177);
+        lower[0x0178] = 0x00FF;
+        pairs(0x0179, 0x017E);
+
+        // Greek
+        lower[0x0386] = 0x03AC;
+        shift(0x0388, 0x038A, 0x25);
+        lower[0x038C] = 0x03CC;
+        shift(0x038E, 0x038F, 0x3F);
+        shift(0x0391, 0x03A1, 0x20);
+        shift(0x03A3, 0x03AB, 0x20);
+        pairs(0x03D8, 0x03EF);
+
+        // Cyrillic
+        shift(0x0400, 0x040F, 0x50);
+        shift(0x0410, 0x042F, 0x20);
+        pairs(0x0460, 0x0481);
+        pairs(0x048A, 0x04BF);
+        lower[0x04C0] = 0x04CF;
+        pairs(0x04C1, 0x04CE);
+        pairs(0x04D0, 0x052F);
+
+        // Armenian
+        shift(0x0531, 0x0556, 0x30);
+
+        return lower;
+    }
+};
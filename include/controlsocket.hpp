@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Unix socket a resident Rex listens on. Clients send a single
+// newline-terminated command ("show") and hang up.
+class ControlSocket final
+{
+public:
+    ControlSocket() : m_fd(-1)
+    {
+    }
+
+    ~ControlSocket()
+    {
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            unlink(m_path.c_str());
+        }
+    }
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    bool listen();
+    int  fd() const;
+
+    // Accepts one pending client and returns its command, or an empty string.
+    std::string acceptCommand();
+
+    static bool send(const std::string& command);
+    static std::string socketPath();
+private:
+    void logError(const std::string& error_message);
+private:
+    int          m_fd;
+    std::string  m_path;
+};
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+#include "indexcache.hpp"
+
+// An application as its .desktop file presents it
+struct DesktopEntry final
+{
+    std::string              m_name;
+    std::vector<std::string> m_argv;
+};
+
+// Reads the XDG desktop entries of the applications directories under
+// $XDG_DATA_HOME and $XDG_DATA_DIRS, subdirectories included: as the spec
+// has it, applications/kde4/foo.desktop has the desktop file ID
+// kde4-foo.desktop.
+//
+// Each file is mapped and only the Type, Name, Exec, NoDisplay, Hidden and
+// Terminal keys of its [Desktop Entry] group are looked at, as views into the
+// mapping; only the resulting name and argv are copied out. Files are parsed
+// in parallel. The results are kept per directory in an IndexCache of their
+// own (desktop.bin), so a directory is only read again after its mtime
+// changes.
+class DesktopEntries final
+{
+public:
+    // Earlier directories take precedence for the same desktop file ID
+    static std::vector<std::string> directories();
+
+    // Every launchable entry, in directory order. Entries hidden, not shown
+    // in menus or meant for a terminal are left out, and so are the
+    // same IDs in later directories. `visited` gets every directory read,
+    // subdirectories included. The `changed` directories are read again
+    // whatever the cache holds for them.
+    static void load(std::vector<DesktopEntry>& entries, std::vector<std::string>& visited,
+                     const std::unordered_set<std::string>& changed = {});
+
+    static bool parse(std::string_view text, DesktopEntry& entry);
+    static bool parseFile(const std::string& path, DesktopEntry& entry);
+
+    // Splits an Exec value into arguments and drops its field codes
+    static std::vector<std::string> splitExec(std::string_view exec);
+private:
+    // Cached form of one file: "id\0name\0argv0\0argv1...". An empty name
+    // marks an ID that hides the same ID in later directories.
+    static std::string encode(std::string_view id, const DesktopEntry& entry);
+    static bool decode(std::string_view record, std::string_view& id, DesktopEntry& entry);
+
+    static void scanDirectory(const std::string& path, const std::string& prefix, std::vector<std::string>& records);
+
+    static void logError(const std::string& error_message);
+};
@@ -21,9 +21,14 @@ public:
     {
     }
 
+    // `application` is either an absolute path, run as is, or a bare name
+    // looked up in $PATH.
     void executeApplicationAndExit(const std::string& application, const std::vector<std::string>& args = {});
+    bool executeApplication(const std::string& application, const std::vector<std::string>& args = {});
+
+    // A resident launcher outlives its children and has to reap them itself.
+    static void installChildReaper();
 private:
-    bool executeApplication(const std::string& application, const std::vector<std::string>& args);
 
     void handleError(const std::string& message);
 };
\ No newline at end of file
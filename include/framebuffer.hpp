@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Offscreen 32 bpp pixels the size of the window. Frames are rasterized into
+// them locally and reach the window in one request per present(). Where the
+// server can map it, the buffer is a MIT-SHM segment and presenting sends no
+// pixel data at all; otherwise the rows go over the socket with PutImage.
+class FrameBuffer final
+{
+public:
+    FrameBuffer() : m_connection(nullptr), m_window(0), m_gc(0), m_width(0), m_height(0), m_stride(0), m_depth(0),
+                    m_data(nullptr), m_shm_id(-1), m_segment(0), m_completion_event(0), m_pending(false), m_pending_put({ 0 })
+    {
+    }
+
+    ~FrameBuffer()
+    {
+        release();
+    }
+
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    // Fails if the window's pixel format is not plain 32 bpp xRGB in host
+    // byte order, which is what gets rasterized into the buffer.
+    bool init(xcb_connection_t* connection, xcb_window_t window, const xcb_screen_t* screen, uint16_t width, uint16_t height);
+
+    unsigned char* data() const
+    {
+        return m_data;
+    }
+
+    int stride() const
+    {
+        return m_stride;
+    }
+
+    bool shared() const
+    {
+        return m_segment != 0;
+    }
+
+    // Copies rows [y, y + height) of the buffer to the window.
+    void present(int y, int height);
+
+    // Blocks until the server has read the last presented rows, after which
+    // the buffer can be drawn into again. Usually already the case: the
+    // server reports it with a ShmCompletion event, which the event loop
+    // passes to handleEvent(). Only otherwise does this cost a round trip.
+    void waitIdle();
+
+    // Returns true for the completion event of the last present(), which is
+    // not meant for anyone else.
+    bool handleEvent(const xcb_generic_event_t* event);
+private:
+    bool attachShm();
+    void release();
+
+    void logError(const std::string& error_message);
+private:
+    xcb_connection_t*           m_connection;
+    xcb_window_t                m_window;
+    xcb_gcontext_t              m_gc;
+    uint16_t                    m_width;
+    uint16_t                    m_height;
+    int                         m_stride;
+    uint8_t                     m_depth;
+
+    unsigned char*              m_data;
+    std::vector<unsigned char>  m_private;
+    int                         m_shm_id;
+    xcb_shm_seg_t               m_segment;
+    uint8_t                     m_completion_event;
+
+    bool                        m_pending;
+    xcb_void_cookie_t           m_pending_put;
+};
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Remembers what was launched, how often and how recently.
+//
+// Launches are appended to a log, one record each. The log is mapped and
+// replayed at startup into one decayed score per name, so lookups are a
+// single hash probe. Every launch adds 1 to a name's score, and scores halve
+// every kHalfLife seconds. After kCompactAfter records the log is rewritten
+// as one record per name, holding its score as the record's weight.
+//
+// Layout (native endianness):
+//   Header | { Record, name padded to 8 bytes }...
+class FrecencyStore final
+{
+public:
+    static constexpr uint32_t kMagic        = 0x46584552; // "REXF"
+    static constexpr uint32_t kVersion      = 1;
+    static constexpr int64_t  kHalfLife     = 7 * 24 * 60 * 60;
+    static constexpr size_t   kCompactAfter = 256;
+    static constexpr double   kForgetBelow  = 0.05;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct Record
+    {
+        int64_t  time;
+        float    weight;
+        uint16_t length;
+        uint16_t reserved;
+    };
+
+    FrecencyStore() : m_records(0)
+    {
+    }
+
+    // Replays the log in `file`. A missing log is an empty history.
+    bool load(const std::string& file);
+
+    // Counts a launch of `name` now and appends it to the log.
+    void record(const std::string& name);
+
+    // The decayed score of `name` at `now`, 0 if it was never launched.
+    double score(const std::string& name, int64_t now) const;
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    static int64_t now();
+    static std::string defaultPath();
+private:
+    struct Entry
+    {
+        double  m_score;
+        int64_t m_time;
+    };
+
+    void apply(const std::string& name, double weight, int64_t time);
+    bool append(const std::string& name, float weight, int64_t time);
+    bool compact();
+
+    static void logError(const std::string& error_message);
+private:
+    std::string                             m_file;
+    std::unordered_map<std::string, Entry>  m_entries;
+    size_t                                  m_records;
+};
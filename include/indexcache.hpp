@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// One $PATH directory as seen by the last scan. The stat identity is what the
+// cache is validated against: a directory is only rescanned when it changes.
+struct PathDirectory final
+{
+    std::string              m_path;
+    uint64_t                 m_device;
+    uint64_t                 m_inode;
+    int64_t                  m_mtime_sec;
+    int64_t                  m_mtime_nsec;
+    std::vector<std::string> m_entries;
+
+    PathDirectory() : m_device(0), m_inode(0), m_mtime_sec(0), m_mtime_nsec(0) {}
+
+    void set_identity(const struct stat& st)
+    {
+        m_device = st.st_dev;
+        m_inode = st.st_ino;
+        m_mtime_sec = st.st_mtim.tv_sec;
+        m_mtime_nsec = st.st_mtim.tv_nsec;
+    }
+
+    bool same_identity(const struct stat& st) const
+    {
+        return m_device == static_cast<uint64_t>(st.st_dev) && m_inode == static_cast<uint64_t>(st.st_ino) &&
+               m_mtime_sec == st.st_mtim.tv_sec && m_mtime_nsec == st.st_mtim.tv_nsec;
+    }
+};
+
+// Versioned on-disk executable index, mapped read-only at startup.
+//
+// Layout (native endianness, every section 8-byte aligned):
+//   Header | DirRecord[dir_count] | WordRecord[word_count] | string pool
+//
+// Directory paths and executable names all live in the string pool; records
+// only hold offsets into it so the file can be used in place.
+class IndexCache final
+{
+public:
+    static constexpr uint32_t kMagic   = 0x49584552; // "REXI"
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t dir_count;
+        uint32_t word_count;
+        uint64_t pool_size;
+    };
+
+    struct DirRecord
+    {
+        uint32_t path_offset;
+        uint32_t path_length;
+        uint64_t device;
+        uint64_t inode;
+        int64_t  mtime_sec;
+        int64_t  mtime_nsec;
+        uint32_t first_word;
+        uint32_t word_count;
+    };
+
+    struct WordRecord
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    IndexCache() : m_data(nullptr), m_size(0), m_header(nullptr), m_dirs(nullptr), m_words(nullptr), m_pool(nullptr)
+    {
+    }
+
+    ~IndexCache()
+    {
+        close();
+    }
+
+    IndexCache(const IndexCache&) = delete;
+    IndexCache& operator=(const IndexCache&) = delete;
+
+    bool open(const std::string& file);
+    void close();
+
+    // Fills `entries` from the cache if the identity of `path` still matches.
+    // Returns false when the directory has to be rescanned.
+    bool lookup(const std::string& path, const struct stat& st, std::vector<std::string_view>& entries) const;
+
+    static bool write(const std::string& file, const std::vector<PathDirectory>& dirs);
+    static std::string defaultPath(const std::string& name = "index.bin");
+private:
+    std::string_view poolString(uint32_t offset, uint32_t length) const;
+    bool validate();
+
+    static void logError(const std::string& error_message);
+private:
+    const char*        m_data;
+    size_t             m_size;
+
+    const Header*      m_header;
+    const DirRecord*   m_dirs;
+    const WordRecord*  m_words;
+    const char*        m_pool;
+};
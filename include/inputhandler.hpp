@@ -11,11 +11,15 @@
 #include "types.hpp"
 #include "executionengine.hpp"
 #include "suggestion.hpp"
+#include "searchworker.hpp"
+#include "latencytracer.hpp"
+#include "prefetcher.hpp"
 
 class InputHandler final 
 {
 public:
-    InputHandler() : m_connection(nullptr), m_suggestion_index(0)
+    InputHandler() : m_connection(nullptr), m_search(m_suggestions), m_search_pending(false), m_search_dirty(false), m_resident(false),
+                     m_dismiss_requested(false), m_suggestion_index(0)
     {
     }
 
@@ -32,14 +36,34 @@ public:
         }
     }
 
-    bool                       init(xcb_connection_t* connection, xcb_window_t window_id, ssize_t max_suggeestions);
-    std::string_view           processEvents(xcb_generic_event_t* event);
+    bool                       init(xcb_connection_t* connection, xcb_window_t window_id, ssize_t max_suggeestions, bool resident = false);
+    // Applies one event and returns true if it changed what is on screen.
+    // Searching is left to flushSearch(), once per batch of events.
+    bool                       processEvents(xcb_generic_event_t* event);
+    void                       flushSearch();
+    void                       reset();
+    bool                       consumeDismissRequest();
+
+    std::vector<std::string>   watchedDirectories() const;
+    void                       applyPathChanges(const PathChanges& changes);
+
+    // Readable once search results are waiting; takeSearchResults() picks
+    // them up and returns true if the suggestions changed.
+    int                        searchResultFd() const;
+    bool                       takeSearchResults();
+    bool                       searchPending() const;
     char                       mapKeysymToChar(xcb_keysym_t keysym);
 
-    std::vector<std::string>&  getSuggestions();
-    ssize_t                    getIndexSuggestion() const;
+    std::string_view              getInputText() const;
+    // Candidate ids; their names are only valid under lockNames()
+    const std::vector<uint32_t>&  getSuggestions() const;
+    const CandidatePool&          getNames() const;
+    std::shared_lock<std::shared_mutex>  lockNames() const;
+    ssize_t                       getIndexSuggestion() const;
 private:
-    void  processKeyPress(xcb_key_press_event_t* k_event);
+    bool  processKeyPress(xcb_key_press_event_t* k_event);
+    void  requestSuggestions();
+    void  updatePrefetch();
     bool  loadKeyMapping();
 
     void  logError(const std::string& error_message);
@@ -50,6 +74,13 @@ private:
 
     ExecutionEngine     m_exec_engine;
     Suggestions         m_suggestions;
+    SearchWorker        m_search;
+    Prefetcher          m_prefetcher;
+    bool                m_search_pending;
+    bool                m_search_dirty;
+
+    bool                m_resident;
+    bool                m_dismiss_requested;
 
     std::string         m_inputBuffer;
 
@@ -60,11 +91,12 @@ private:
 
     std::vector<std::vector<xcb_keysym_t>>  m_keysyms;
 
+    xcb_get_keyboard_mapping_cookie_t       m_mapping_cookie;
     bool                                    m_keysyms_loaded;
     xcb_get_keyboard_mapping_reply_t*       m_reply;
     xcb_key_symbols_t*                      m_key_symbols;
 
     ssize_t                                 m_suggestion_index;
     ssize_t                                 m_max_suggestion;
-    std::vector<std::string>                m_text_suggestions;
+    std::vector<uint32_t>                   m_text_suggestions;
 };
\ No newline at end of file
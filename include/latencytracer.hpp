@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Optional timing of startup and of every stage between a key press and the
+// frame that shows its result. Enabled by setting REX_TRACE to a file name:
+// each stage then feeds a log-linear histogram (HdrHistogram style, about 3%
+// precision) and a list of trace events. At exit p50/p99 per stage go to
+// stderr and the events to the file, in Chrome's trace event format (open it
+// in chrome://tracing or Perfetto).
+//
+// Counters tally events that have no duration, and are reported likewise.
+//
+// Disabled, a Scope costs one load of a global flag.
+class LatencyTracer final
+{
+public:
+    enum class Stage
+    {
+        Connect,
+        PathScan,
+        FontInit,
+        FirstFrame,
+        KeyPress,
+        Match,
+        DrawSearchBar,
+        DrawSuggestions,
+        Present,
+        Keystroke,
+        Count
+    };
+
+    enum class Counter
+    {
+        Prefetches,
+        PrefetchBytes,
+        PrefetchHits,
+        PrefetchHitBytes,
+        Count
+    };
+
+    class Scope final
+    {
+    public:
+        explicit Scope(Stage stage) : m_stage(stage), m_start(enabled() ? now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (m_start)
+            {
+                record(m_stage, m_start, now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Stage    m_stage;
+        uint64_t m_start;
+    };
+
+    // Reads REX_TRACE; call once, before any other thread starts
+    static void initFromEnvironment();
+
+    static bool enabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Monotonic nanoseconds, never 0
+    static uint64_t now();
+    static void record(Stage stage, uint64_t start, uint64_t end);
+    static void count(Counter counter, uint64_t amount);
+
+    static void report();
+private:
+    static const char* stageName(Stage stage);
+    static const char* counterName(Counter counter);
+    static void logError(const std::string& error_message);
+
+    static inline std::atomic<bool> s_enabled{false};
+};
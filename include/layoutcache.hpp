@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Least recently used cache of shaped PangoLayouts, one per distinct text in
+// the current font. Itemizing and shaping happen once per text; drawing an
+// unchanged suggestion row again only replays its glyphs. Bounded both by
+// entry count and by the total length of the cached texts.
+class LayoutCache final
+{
+public:
+    static constexpr size_t kMaxEntries = 64;
+    static constexpr size_t kMaxBytes   = 16 * 1024;
+
+    LayoutCache() : m_font(nullptr), m_bytes(0), m_hits(0), m_misses(0)
+    {
+    }
+
+    ~LayoutCache();
+
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    // Layouts depend on the font, so this drops every cached one.
+    void setFont(const std::string& font_description);
+
+    // The layout for `text`, shaped for `cr` on a miss. Valid until the next
+    // call.
+    PangoLayout* get(cairo_t* cr, std::string_view text);
+
+    void clear();
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    uint64_t hits() const
+    {
+        return m_hits;
+    }
+
+    uint64_t misses() const
+    {
+        return m_misses;
+    }
+
+    double hitRate() const
+    {
+        uint64_t lookups = m_hits + m_misses;
+        return lookups ? static_cast<double>(m_hits) / lookups : 0.0;
+    }
+private:
+    struct Entry
+    {
+        std::string   m_text;
+        PangoLayout*  m_layout;
+    };
+
+    void evict();
+private:
+    PangoFontDescription*  m_font;
+
+    // Most recently used first. The index keys view into the list nodes,
+    // which never move.
+    std::list<Entry>                                                m_entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;
+    size_t                                                          m_bytes;
+
+    uint64_t  m_hits;
+    uint64_t  m_misses;
+};
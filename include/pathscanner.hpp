@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Lists the executables of $PATH directories with as few syscalls as possible:
+// entries are read in bulk with getdents64 and d_type rules out directories,
+// sockets and the like without touching them. Only regular files, symlinks and
+// entries of unknown type cost one fstatat() relative to the directory fd.
+class PathScanner final
+{
+public:
+    // Scans `directories` concurrently; entries[i] receives the executables of
+    // directories[i], so callers can merge them back in $PATH order.
+    static void scan(const std::vector<std::string>& directories, std::vector<std::vector<std::string>>& entries);
+
+    static bool scanDirectory(const std::string& path, std::vector<std::string>& entries);
+    static bool isExecutable(const std::string& dir, const std::string& name);
+private:
+    static void logError(const std::string& error_message);
+};
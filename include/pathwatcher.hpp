@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// A batch of filesystem changes under the watched directories.
+struct PathChanges final
+{
+    // Directory path -> names created, removed, renamed or chmod'ed in it
+    std::unordered_map<std::string, std::unordered_set<std::string>> m_changed;
+    // Directories whose events were lost and must be rescanned as a whole
+    std::unordered_set<std::string>                                  m_rescan;
+
+    bool empty() const
+    {
+        return m_changed.empty() && m_rescan.empty();
+    }
+
+    void clear()
+    {
+        m_changed.clear();
+        m_rescan.clear();
+    }
+};
+
+// Watches the $PATH and applications directories with inotify and batches
+// what it sees. The batch is held back until the directories have been quiet
+// for a short while (or a hard deadline passes), so a package manager
+// touching hundreds of files produces a single index update.
+//
+// A directory that is missing at startup, deleted or moved away has no watch.
+// It is watched, and rescanned, as soon as something exists at its path
+// again: retried with every batch and every kRetryPeriod in between.
+class PathWatcher final
+{
+public:
+    PathWatcher() : m_inotify_fd(-1), m_timer_fd(-1), m_batch_open(false)
+    {
+    }
+
+    ~PathWatcher()
+    {
+        if (m_inotify_fd >= 0)
+        {
+            close(m_inotify_fd);
+        }
+
+        if (m_timer_fd >= 0)
+        {
+            close(m_timer_fd);
+        }
+    }
+
+    PathWatcher(const PathWatcher&) = delete;
+    PathWatcher& operator=(const PathWatcher&) = delete;
+
+    bool watch(const std::vector<std::string>& directories);
+
+    int  inotifyFd() const;
+    int  timerFd() const;
+
+    // Call when inotifyFd() is readable.
+    void readEvents();
+    // Call when timerFd() is readable; hands out the finished batch.
+    bool takeChanges(PathChanges& changes);
+private:
+    void armTimer();
+    void armRetry();
+    bool addWatch(const std::string& directory);
+    void rewatchLost();
+
+    void logError(const std::string& error_message);
+private:
+    static constexpr std::chrono::milliseconds kQuietPeriod{150};
+    static constexpr std::chrono::milliseconds kMaxDelay{1000};
+    static constexpr std::chrono::seconds      kRetryPeriod{5};
+
+    int  m_inotify_fd;
+    int  m_timer_fd;
+
+    std::unordered_map<int, std::string>   m_watches;
+    // Directories currently without a watch, to be watched again
+    std::unordered_set<std::string>        m_lost;
+
+    PathChanges                            m_pending;
+    bool                                   m_batch_open;
+    std::chrono::steady_clock::time_point  m_batch_start;
+};
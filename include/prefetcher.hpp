@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+#include "latencytracer.hpp"
+
+// Warms the page cache for the program the user is about to launch.
+//
+// Once a selection has stayed the same for kDebounce, a background thread
+// running at idle CPU and I/O priority resolves it to a program, then reads
+// that binary and the shared libraries it needs into the page cache. Those
+// are the DT_NEEDED entries, followed transitively. Pages that are already
+// resident are skipped, so only cold data costs I/O. The library list of
+// every binary is resolved once and cached.
+//
+// With REX_TRACE set, the tracer reports how many bytes were prefetched and
+// how many of them belonged to a program that was then launched.
+class Prefetcher final
+{
+public:
+    static constexpr std::chrono::milliseconds kDebounce{150};
+
+    // Libraries followed per binary, enough for a browser
+    static constexpr size_t kMaxFiles = 256;
+
+    static constexpr uint32_t kNoSelection = std::numeric_limits<uint32_t>::max();
+
+    // Turns a selected candidate into the absolute path of the program it
+    // launches, or an empty string. Called on the prefetch thread.
+    using Resolver = std::function<std::string(uint32_t)>;
+
+    Prefetcher() : m_stopping(false), m_selection(kNoSelection), m_selection_time(), m_prefetched(kNoSelection), m_prefetched_bytes(0)
+    {
+    }
+
+    ~Prefetcher()
+    {
+        stop();
+    }
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    bool start(Resolver resolve);
+    void stop();
+
+    // The candidate Return would launch now, or kNoSelection. Cheap enough
+    // for every keystroke: nothing is resolved until the debounce expires.
+    void select(uint32_t candidate);
+
+    // Tells the prefetcher what was launched, to count its hits
+    void launched(const std::string& path);
+private:
+    void run();
+    uint64_t prefetch(uint32_t candidate, const std::string& path);
+    const std::vector<std::string>& dependencies(const std::string& path);
+
+    static void logError(const std::string& error_message);
+private:
+    std::thread                                m_thread;
+
+    std::mutex                                 m_mutex;
+    std::condition_variable                    m_wake;
+    bool                                       m_stopping;
+    uint32_t                                   m_selection;
+    std::chrono::steady_clock::time_point      m_selection_time;
+
+    // Last selection prefetched, its program and how many bytes that read
+    uint32_t                                   m_prefetched;
+    std::string                                m_prefetched_path;
+    uint64_t                                   m_prefetched_bytes;
+
+    // Only touched by the prefetch thread
+    Resolver                                   m_resolve;
+    std::unordered_map<std::string, std::vector<std::string>>  m_dependencies;
+    std::vector<std::string>                   m_search_dirs;
+};
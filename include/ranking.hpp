@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Scores how well `query` matches `word` as a subsequence, higher is better.
+//
+// The match is aligned like fzf's v1 algorithm: a greedy forward pass finds
+// where the shortest match ends, and a backward pass from there pulls its start
+// as far right as possible. Within that window each matched character earns a
+// base score plus bonuses for starting the word, starting a word segment
+// ("-", "_", ".", camelCase and letter/digit transitions) and extending a run
+// of consecutive matches; every gap between matches costs a penalty.
+struct MatchScorer final
+{
+    static constexpr int kMatch            = 16;
+    static constexpr int kPrefixBonus      = 24;
+    static constexpr int kBoundaryBonus    = 12;
+    static constexpr int kConsecutiveBonus = 10;
+    static constexpr int kGapStart         = -5;
+    static constexpr int kGapExtension     = -1;
+    static constexpr int kLeadingGap       = -1;
+    static constexpr int kMaxLeadingGap    = -12;
+    static constexpr int kFrecencyBonus    = 20;
+    static constexpr int kMaxFrecencyBonus = 80;
+
+    static int score(std::string_view query, std::string_view word)
+    {
+        if (query.empty() || query.size() > word.size())
+        {
+            return std::numeric_limits<int>::min();
+        }
+
+        // Forward: leftmost end of a complete match
+        size_t q = 0;
+        size_t end = 0;
+        for (; end < word.size(); ++end)
+        {
+            if (word[end] == query[q] && ++q == query.size())
+            {
+                break;
+            }
+        }
+
+        if (q != query.size())
+        {
+            return std::numeric_limits<int>::min();
+        }
+
+        return score(query, word, end);
+    }
+
+    // Same, for a word already known to match with its greedy forward match
+    // ending at `end` (the incremental matcher tracks exactly that).
+    static int score(std::string_view query, std::string_view word, size_t end)
+    {
+        return score(query, word, word, end);
+    }
+
+    // Same again, with characters compared in `matched` and word boundaries
+    // taken from `word`. Smart-case matching passes the case-folded name as
+    // `matched`, which has the same length, so camelCase still counts.
+    static int score(std::string_view query, std::string_view matched, std::string_view word, size_t end)
+    {
+        // Backward: rightmost start that still matches up to `end`
+        size_t start = end;
+        for (size_t remaining = query.size(); ; --start)
+        {
+            if (matched[start] == query[remaining - 1] && --remaining == 0)
+            {
+                break;
+            }
+        }
+
+        int total = std::max(kMaxLeadingGap, static_cast<int>(start) * kLeadingGap);
+        size_t previous = std::string_view::npos;
+        size_t q = 0;
+
+        for (size_t pos = start; pos <= end && q < query.size(); ++pos)
+        {
+            if (matched[pos] != query[q])
+            {
+                continue;
+            }
+
+            int bonus = 0;
+            if (pos == 0)
+            {
+                bonus = kPrefixBonus;
+            }
+            else if (is_boundary(word[pos - 1], word[pos]))
+            {
+                bonus = kBoundaryBonus;
+            }
+
+            // The first character sets the tone of the whole match
+            if (q == 0)
+            {
+                bonus *= 2;
+            }
+
+            if (previous != std::string_view::npos)
+            {
+                size_t gap = pos - previous - 1;
+                if (gap == 0)
+                {
+                    bonus += kConsecutiveBonus;
+                }
+                else
+                {
+                    total += kGapStart + static_cast<int>(gap - 1) * kGapExtension;
+                }
+            }
+
+            total += kMatch + bonus;
+            previous = pos;
+            ++q;
+        }
+
+        return total;
+    }
+
+    // Bonus for a name's launch history: kFrecencyBonus per doubling of its
+    // frecency score, so a single recent launch already outweighs the
+    // difference between a prefix match and a boundary match.
+    static int frecency_bonus(double frecency)
+    {
+        if (frecency <= 0.0)
+        {
+            return 0;
+        }
+
+        return std::min(kMaxFrecencyBonus, static_cast<int>(kFrecencyBonus * std::log2(1.0 + frecency)));
+    }
+
+private:
+    static bool is_boundary(char before, char current)
+    {
+        bool before_lower = before >= 'a' && before <= 'z';
+        bool before_upper = before >= 'A' && before <= 'Z';
+        bool before_digit = before >= '0' && before <= '9';
+
+        // Plain ASCII tests: <cctype> goes through the locale on every call
+        if (!before_lower && !before_upper && !before_digit)
+        {
+            return true;
+        }
+
+        if (before_lower && current >= 'A' && current <= 'Z')
+        {
+            return true;
+        }
+
+        return !before_digit && current >= '0' && current <= '9';
+    }
+};
+
+struct RankedCandidate final
+{
+    int32_t  m_score;
+    uint16_t m_length;
+    uint32_t m_candidate;
+
+    // Higher score first, then shorter names, then earlier in $PATH order
+    bool better_than(const RankedCandidate& other) const
+    {
+        if (m_score != other.m_score)
+        {
+            return m_score > other.m_score;
+        }
+
+        if (m_length != other.m_length)
+        {
+            return m_length < other.m_length;
+        }
+
+        return m_candidate < other.m_candidate;
+    }
+};
+
+// Keeps the K best candidates offered to it in a fixed-size heap whose root
+// is the worst of them, so every offer is O(log K) and nothing beyond K
+// entries is ever stored or sorted.
+class TopK final
+{
+public:
+    TopK() : m_limit(0)
+    {
+    }
+
+    void reset(size_t limit)
+    {
+        m_limit = limit;
+        m_heap.clear();
+        m_heap.reserve(limit);
+    }
+
+    void offer(const RankedCandidate& candidate)
+    {
+        if (m_heap.size() < m_limit)
+        {
+            m_heap.push_back(candidate);
+            std::push_heap(m_heap.begin(), m_heap.end(), worse_on_top);
+        }
+        else if (m_limit > 0 && candidate.better_than(m_heap.front()))
+        {
+            std::pop_heap(m_heap.begin(), m_heap.end(), worse_on_top);
+            m_heap.back() = candidate;
+            std::push_heap(m_heap.begin(), m_heap.end(), worse_on_top);
+        }
+    }
+
+    // Best first. Consumes the heap order, so call once per query.
+    const std::vector<RankedCandidate>& sorted()
+    {
+        std::sort(m_heap.begin(), m_heap.end(), worse_on_top);
+        return m_heap;
+    }
+
+private:
+    static bool worse_on_top(const RankedCandidate& a, const RankedCandidate& b)
+    {
+        return a.better_than(b);
+    }
+
+    size_t                       m_limit;
+    std::vector<RankedCandidate> m_heap;
+};
@@ -10,18 +10,30 @@
 
 #include "types.hpp"
 #include "inputhandler.hpp"
+#include "controlsocket.hpp"
+#include "pathwatcher.hpp"
 #include "ui.hpp"
+#include "latencytracer.hpp"
 
 class Rex final
 {
 public:
-    Rex() : m_index_suggestion(0)
+    explicit Rex(bool resident = false) : m_index_suggestion(0), m_resident(resident), m_visible(!resident), m_input_time(0)
     {
         init();
 
+        // Startup requests go out first and are answered while the index is
+        // built, so waiting for them costs about one round trip in total.
         xcb_window_t id = xcb_generate_id(m_connection);
-        m_inputHandler.init(m_connection, id, 6);
-        m_ui.init(m_connection, id);
+        m_ui.prefetch(m_connection);
+        m_inputHandler.init(m_connection, id, 6, m_resident);
+        m_ui.init(m_connection, id, m_visible);
+
+        // Only a long-lived instance can go stale
+        if (m_resident)
+        {
+            m_watcher.watch(m_inputHandler.watchedDirectories());
+        }
     }
 
     ~Rex()
@@ -33,11 +45,27 @@ public:
 public:
     xcb_connection_t*           m_connection;
     std::string_view            m_renderTextBuffer;
-    std::vector<std::string>    m_renderSuggestions;
 
+private:
+    bool handleEvent(xcb_generic_event_t* event);
+    void handleCommand(const std::string& command);
+    void handlePathChanges();
+    void handleSearchResults();
+    void render();
+
+    void show();
+    void hide();
 private:
     InputHandler   m_inputHandler;
     UI             m_ui;
+    ControlSocket  m_control;
+    PathWatcher    m_watcher;
 
     ssize_t        m_index_suggestion;
+
+    bool           m_resident;
+    bool           m_visible;
+
+    // When the input of the frame being worked towards arrived, if tracing
+    uint64_t       m_input_time;
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+#include "spscqueue.hpp"
+#include "suggestion.hpp"
+
+// Runs every search, and every change to the index, on a thread of its own
+// so the X event loop never waits for matching.
+//
+// Requests flow from the event loop to the worker through one SPSC queue and
+// results come back through another. Each queue has an eventfd that is
+// signalled after a push: the worker blocks on its own, and resultFd() is
+// meant to be polled next to the X connection. Once started, the worker owns
+// the Suggestions; the event loop only ever bumps its search generation and
+// reads names under their read lock.
+//
+// Searches and their results are written into and read from the queue slots
+// in place, so typing allocates nothing once the slots have grown.
+class SearchWorker final
+{
+public:
+    struct Request
+    {
+        enum class Kind
+        {
+            Search,
+            PathChanges,
+            Launch,
+            Stop
+        };
+
+        Kind         m_kind = Kind::Search;
+        uint64_t     m_generation = 0;
+        int          m_limit = 0;
+        std::string  m_text;
+        PathChanges  m_changes;
+    };
+
+    struct Result
+    {
+        uint64_t               m_generation = 0;
+        std::vector<uint32_t>  m_matches;
+    };
+
+    explicit SearchWorker(Suggestions& suggestions) : m_suggestions(suggestions), m_request_fd(-1), m_result_fd(-1), m_latest(0)
+    {
+    }
+
+    ~SearchWorker()
+    {
+        stop();
+    }
+
+    SearchWorker(const SearchWorker&) = delete;
+    SearchWorker& operator=(const SearchWorker&) = delete;
+
+    bool start();
+
+    // Finishes every queued request, then joins the thread. The Suggestions
+    // belong to the caller again afterwards.
+    void stop();
+
+    // Queues a search for `query`, superseding and aborting any earlier one.
+    // Returns the generation its results will carry.
+    uint64_t search(std::string_view query, int limit);
+
+    // Drops whatever search is pending without starting a new one.
+    void cancel();
+
+    void applyPathChanges(PathChanges changes);
+    void recordLaunch(const std::string& name);
+
+    int resultFd() const
+    {
+        return m_result_fd;
+    }
+
+    // Collects the results that arrived since the last call. Returns true and
+    // fills `matches` with candidate ids if those of the latest search are
+    // among them; results of superseded searches are dropped.
+    bool takeResults(std::vector<uint32_t>& matches);
+
+    // Blocks until the latest search has delivered.
+    void waitForResults(std::vector<uint32_t>& matches);
+private:
+    void post(Request& request);
+    void run();
+    // Returns false for the request to stop
+    bool handle(Request& request);
+
+    static void signal(int fd);
+    static void logError(const std::string& error_message);
+private:
+    static constexpr size_t kQueueCapacity = 64;
+
+    Suggestions&                        m_suggestions;
+    std::thread                         m_thread;
+
+    SpscQueue<Request, kQueueCapacity>  m_requests;
+    SpscQueue<Result, kQueueCapacity>   m_results;
+    int                                 m_request_fd;
+    int                                 m_result_fd;
+
+    uint64_t                            m_latest;
+
+    // Only touched by the worker: where searches write their ids
+    std::vector<uint32_t>               m_matches;
+};
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+//
+// Head and tail only ever grow and are reduced to a slot on access. Each sits
+// on its own cache line, so the two sides never contend for one.
+template <typename T, size_t Capacity>
+class SpscQueue final
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SpscQueue() : m_head(0), m_tail(0)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false, leaving `value` untouched, when full.
+    bool try_push(T& value)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        m_slots[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool try_pop(T& value)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = std::move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: `fill` writes the value straight into its slot, where
+    // strings and vectors keep the capacity of earlier values, so pushing
+    // allocates nothing once every slot has held one. Returns false when full.
+    template <typename Fill>
+    bool try_push_in_place(Fill&& fill)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        fill(m_slots[tail & (Capacity - 1)]);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: `use` reads the value in its slot, which is only handed
+    // back to the producer once it returns. Returns false when empty.
+    template <typename Use>
+    bool try_pop_in_place(Use&& use)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        use(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    std::array<T, Capacity>         m_slots;
+};
@@ -9,126 +9,369 @@
 #pragma once
 
 #include "types.hpp"
-
-#pragma once
+#include "indexcache.hpp"
+#include "pathwatcher.hpp"
+#include "pathscanner.hpp"
+#include "candidatepool.hpp"
+#include "threadpool.hpp"
+#include "ranking.hpp"
+#include "frecencystore.hpp"
+#include "latencytracer.hpp"
+#include "desktopentries.hpp"
+#include "casefold.hpp"
 
 namespace fs = std::filesystem;
 
-struct TrieNode final
+class Suggestions final
 {
-    bool m_is_end_of_word;
-    std::unordered_map<char, std::unique_ptr<TrieNode>> m_children;
+public:
+    // Candidates per unit of matching work: one chunk's names, offsets and
+    // survivor lists stay within a core's L2 cache.
+    static constexpr size_t kChunkSize = 4096;
 
-    TrieNode() : m_is_end_of_word(false) {}
-};
+    // Below this many candidates to scan, waking other threads costs more
+    // than it saves.
+    static constexpr size_t kParallelThreshold = 8 * kChunkSize;
+    static constexpr size_t kMaxSearchThreads = 8;
 
-struct Trie final
-{
-    Trie() : m_root(std::make_unique<TrieNode>()) 
-    {}
+    Suggestions() : m_query_depth(0), m_query_folded(false), m_generation(0), m_bonus_time(0),
+                    m_search_threads(std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxSearchThreads)) {}
 
-    void insert(const std::string& word)
+    void populate_from_path()
     {
-        TrieNode* node = m_root.get();
-        for (char ch : word)
+        std::string history_file = FrecencyStore::defaultPath();
+        if (!history_file.empty())
+        {
+            m_frecency.load(history_file);
+        }
+
+        const char* path_env = std::getenv("PATH");
+        if (!path_env)
+        {
+            std::cerr << "Error: PATH environment variable not found.\n";
+            return;
+        }
+
+        std::string path_var(path_env);
+        std::vector<std::string> paths = split(path_var, ':');
+
+        std::string cache_file = IndexCache::defaultPath();
+        IndexCache cache;
+        if (!cache_file.empty())
+        {
+            cache.open(cache_file);
+        }
+
+        std::vector<std::string_view> cached_entries;
+        std::vector<size_t> stale;
+        std::vector<std::string> stale_paths;
+        bool resorted = false;
+
+        for (const auto& path : paths)
         {
-            if (node->m_children.find(ch) == node->m_children.end())
+            // The identity is taken before scanning, so a directory modified
+            // mid-scan simply looks stale on the next start.
+            if (path.empty())
             {
-                node->m_children[ch] = std::make_unique<TrieNode>();
+                continue;
+            }
+
+            // A directory that does not exist yet keeps its place, empty, so
+            // the watcher looks for it and $PATH order holds once it appears.
+            struct stat st;
+            if (stat(path.c_str(), &st) < 0 || !S_ISDIR(st.st_mode))
+            {
+                std::cerr << "Skipping invalid path: " << path << "\n";
+                PathDirectory missing;
+                missing.m_path = path;
+                m_dirs.push_back(std::move(missing));
+                continue;
             }
-            node = node->m_children[ch].get();
+
+            PathDirectory dir;
+            dir.m_path = path;
+            dir.set_identity(st);
+
+            if (cache.lookup(path, st, cached_entries))
+            {
+                dir.m_entries.assign(cached_entries.begin(), cached_entries.end());
+                resorted |= sort_entries(dir);
+            }
+            else
+            {
+                stale.push_back(m_dirs.size());
+                stale_paths.push_back(path);
+            }
+
+            m_dirs.push_back(std::move(dir));
         }
-        node->m_is_end_of_word = true;
-    }
 
-    std::vector<std::string> get_matches(const std::string& prefix) const
-    {
-        TrieNode* node = m_root.get();
-        std::vector<std::string> matches;
+        cache.close();
+
+        bool cache_dirty = !stale.empty() || resorted;
+        if (!stale.empty())
+        {
+            std::vector<std::vector<std::string>> scanned;
+            PathScanner::scan(stale_paths, scanned);
+
+            for (size_t i = 0; i < stale.size(); ++i)
+            {
+                m_dirs[stale[i]].m_entries = std::move(scanned[i]);
+                sort_entries(m_dirs[stale[i]]);
+            }
+        }
 
-        for (char ch : prefix)
+        // Merge in $PATH order so the first directory providing a name wins
+        for (const auto& dir : m_dirs)
         {
-            if (node->m_children.find(ch) == node->m_children.end())
+            for (const auto& entry : dir.m_entries)
             {
-                return matches;
+                add_word(entry);
             }
-            node = node->m_children[ch].get();
         }
 
-        collect_matches(node, prefix, matches);
-        return matches;
+        if (cache_dirty && !cache_file.empty())
+        {
+            IndexCache::write(cache_file, m_dirs);
+        }
     }
 
-private:
-    void collect_matches(TrieNode* node, const std::string& current, std::vector<std::string>& matches) const
+    // Adds the applications of the XDG desktop entries under their display
+    // names. A name already taken, by $PATH or an earlier entry, keeps its
+    // first meaning.
+    void populate_from_desktop_entries()
     {
-        if (!node)
-            return;
+        std::vector<DesktopEntry> entries;
+        DesktopEntries::load(entries, m_desktop_dirs);
 
-        if (node->m_is_end_of_word)
+        for (auto& entry : entries)
         {
-            matches.push_back(current);
+            if (indexed(entry.m_name))
+            {
+                continue;
+            }
+
+            add_word(entry.m_name);
+            if (indexed(entry.m_name))
+            {
+                m_desktop.emplace(std::move(entry.m_name), std::move(entry.m_argv));
+            }
         }
+    }
 
-        for (const auto& [ch, child] : node->m_children)
+    // Applies a batch of watcher events: the touched directories are brought
+    // up to date first, then every touched name is inserted into or erased from
+    // the index depending on whether any $PATH directory still provides it.
+    // A change under the applications directories reloads the desktop entries
+    // as a whole; their names count as touched before and after.
+    void apply_path_changes(const PathChanges& changes)
+    {
+        // Parsed before taking the lock, which only covers swapping them in
+        std::vector<DesktopEntry> entries;
+        bool desktop_changed = touches_desktop(changes);
+        if (desktop_changed)
         {
-            collect_matches(child.get(), current + ch, matches);
+            std::unordered_set<std::string> changed(changes.m_rescan.begin(), changes.m_rescan.end());
+            for (const auto& [path, names] : changes.m_changed)
+            {
+                changed.insert(path);
+            }
+
+            m_desktop_dirs.clear();
+            DesktopEntries::load(entries, m_desktop_dirs, changed);
         }
-    }
 
-private:
-    std::unique_ptr<TrieNode> m_root;
-};
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        std::unordered_set<std::string> touched;
 
-class Suggestions final
-{
-public:
-    Suggestions() : m_trie(std::make_unique<Trie>()) {}
+        for (auto& dir : m_dirs)
+        {
+            auto changed = changes.m_changed.find(dir.m_path);
+            bool rescan = changes.m_rescan.count(dir.m_path) > 0;
+            if (!rescan && changed == changes.m_changed.end())
+            {
+                continue;
+            }
 
-    void populate_from_path()
-    {
-        const char* path_env = std::getenv("PATH");
-        if (!path_env)
+            struct stat st;
+            bool alive = stat(dir.m_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+            if (alive)
+            {
+                dir.set_identity(st);
+            }
+
+            if (rescan || !alive)
+            {
+                std::vector<std::string> entries;
+                if (alive)
+                {
+                    PathScanner::scanDirectory(dir.m_path, entries);
+                }
+
+                touched.insert(dir.m_entries.begin(), dir.m_entries.end());
+                touched.insert(entries.begin(), entries.end());
+                dir.m_entries = std::move(entries);
+                sort_entries(dir);
+                continue;
+            }
+
+            const auto& names = changed->second;
+            dir.m_entries.erase(std::remove_if(dir.m_entries.begin(), dir.m_entries.end(),
+                                               [&names](const std::string& entry)
+                                               {
+                                                   return names.count(entry) > 0;
+                                               }),
+                                dir.m_entries.end());
+
+            for (const auto& name : names)
+            {
+                touched.insert(name);
+                if (PathScanner::isExecutable(dir.m_path, name))
+                {
+                    dir.m_entries.push_back(name);
+                }
+            }
+            sort_entries(dir);
+        }
+
+        if (touched.empty() && !desktop_changed)
         {
-            std::cerr << "Error: PATH environment variable not found.\n";
             return;
         }
 
-        std::string path_var(path_env);
-        std::vector<std::string> paths = split(path_var, ':');
+        std::unordered_set<std::string_view> provided;
+        for (const auto& dir : m_dirs)
+        {
+            provided.insert(dir.m_entries.begin(), dir.m_entries.end());
+        }
 
-        for (const auto& path : paths)
+        if (desktop_changed)
         {
-            if (!fs::exists(path) || !fs::is_directory(path))
+            for (const auto& [name, argv] : m_desktop)
             {
-                std::cerr << "Skipping invalid path: " << path << "\n";
-                continue;
+                touched.insert(name);
             }
+            m_desktop.clear();
 
-            try
+            // As at startup, $PATH and earlier entries keep their names
+            for (auto& entry : entries)
             {
-                for (const auto& entry : fs::directory_iterator(path))
+                if (provided.count(entry.m_name) == 0 && m_desktop.count(entry.m_name) == 0)
                 {
-                    if (entry.is_regular_file())
-                    {
-                        auto perms = entry.status().permissions();
-
-                        if ((perms & fs::perms::owner_exec) != fs::perms::none ||
-                            (perms & fs::perms::group_exec) != fs::perms::none ||
-                            (perms & fs::perms::others_exec) != fs::perms::none)
-                        {
-                            std::string filename = entry.path().filename().string();
-
-                            add_word(filename);
-                        }
-                    }
+                    touched.insert(entry.m_name);
+                    m_desktop.emplace(std::move(entry.m_name), std::move(entry.m_argv));
                 }
             }
-            catch (const std::exception& e)
+        }
+
+        for (const auto& name : touched)
+        {
+            bool present = provided.count(name) > 0 || m_desktop.count(name) > 0;
+
+            if (present && !indexed(name))
+            {
+                add_word(name);
+            }
+            else if (!present && indexed(name))
+            {
+                // Both pools keep the id, for the same name to come back to
+                uint32_t id = m_candidates.find(name);
+                m_candidates.remove(id);
+                m_folded.remove(id);
+                invalidate_query_cache();
+            }
+        }
+
+        // Only this thread changes m_dirs, so readers need not wait for this
+        lock.unlock();
+
+        std::string cache_file = IndexCache::defaultPath();
+        if (!cache_file.empty())
+        {
+            IndexCache::write(cache_file, m_dirs);
+        }
+    }
+
+    // The $PATH directories, then every applications root, present or not,
+    // and the subdirectories found under them by the last load. A
+    // subdirectory created later is read on the next change to a watched
+    // directory, but not watched itself.
+    std::vector<std::string> directories() const
+    {
+        std::vector<std::string> paths;
+        for (const auto& dir : m_dirs)
+        {
+            paths.push_back(dir.m_path);
+        }
+
+        std::vector<std::string> roots = DesktopEntries::directories();
+        paths.insert(paths.end(), roots.begin(), roots.end());
+        for (const auto& path : m_desktop_dirs)
+        {
+            if (std::find(roots.begin(), roots.end(), path) == roots.end())
+            {
+                paths.push_back(path);
+            }
+        }
+        return paths;
+    }
+
+    // Where launching `name` finds it: the first $PATH directory providing
+    // it, as an absolute path. Empty for names the index does not know.
+    std::string resolve(const std::string& name) const
+    {
+        for (const auto& dir : m_dirs)
+        {
+            if (std::binary_search(dir.m_entries.begin(), dir.m_entries.end(), name))
+            {
+                return dir.m_path + "/" + name;
+            }
+        }
+        return {};
+    }
+
+    // The name a search returned `id` for. Once the worker runs, only valid
+    // under a read_lock().
+    std::string_view name(uint32_t id) const
+    {
+        return m_candidates.get(id);
+    }
+
+    const CandidatePool& names() const
+    {
+        return m_candidates;
+    }
+
+    // Once the worker thread runs it owns the index, while the event loop
+    // still reads names and commands for the ids it was handed. From then on
+    // apply_path_changes() is the only writer and holds this exclusively;
+    // readers keep a read lock for as long as they use what they read.
+    std::shared_lock<std::shared_mutex> read_lock() const
+    {
+        return std::shared_lock<std::shared_mutex>(m_mutex);
+    }
+
+    // The argv launching `name`, its program resolved like resolve() where
+    // the index knows it. Empty for names the index does not know.
+    std::vector<std::string> command(const std::string& name) const
+    {
+        auto desktop = m_desktop.find(name);
+        if (desktop == m_desktop.end())
+        {
+            std::string path = resolve(name);
+            return path.empty() ? std::vector<std::string>() : std::vector<std::string>{ path };
+        }
+
+        std::vector<std::string> argv = desktop->second;
+        if (argv[0].find('/') == std::string::npos)
+        {
+            std::string path = resolve(argv[0]);
+            if (!path.empty())
             {
-                std::cerr << "Error accessing directory '" << path << "': " << e.what() << "\n";
+                argv[0] = std::move(path);
             }
         }
+        return argv;
     }
 
     void add_word(const std::string& word)
@@ -137,61 +380,209 @@ public:
         if (word.empty() || word.size() == 1 || std::none_of(word.begin(), word.end(), ::isalnum))
             return;
 
-        m_trie->insert(word);
-        m_all_words.push_back(word);
+        // The same name in a later $PATH directory is shadowed by the first
+        // one. A name that comes back gets its old id.
+        uint32_t id = m_candidates.find(word);
+        if (id == CandidatePool::kNone)
+        {
+            m_candidates.intern(word);
+            m_folded.add(CaseFold::fold(word));
+        }
+        else if (m_candidates.removed(id))
+        {
+            m_candidates.restore(id);
+            m_folded.restore(id);
+        }
+        else
+        {
+            return;
+        }
+
+        invalidate_query_cache();
+    }
+
+    void record_launch(const std::string& name)
+    {
+        m_frecency.record(name);
+        m_bonus.clear();
     }
 
-    std::vector<std::string> get_exact_matches(const std::string& prefix) const
+    std::vector<std::string> get_fuzzy_matches(const std::string& input, int max_distance = 2)
     {
-        return m_trie->get_matches(prefix);
+        std::vector<uint32_t> ids(static_cast<size_t>(std::max(max_distance, 0)));
+        size_t count = 0;
+        search(input, m_generation.load(std::memory_order_relaxed), ids.data(), ids.size(), count);
+        return to_names(ids.data(), count);
     }
 
-    std::vector<std::string> get_fuzzy_matches(const std::string& input, int max_distance = 2) const
+    // Writes the ids of the best `capacity` candidates for `input` to `ids`,
+    // best first, and how many there are to `count`. Gives up and returns
+    // false as soon as cancel_search() moves the generation past
+    // `generation`, which may be called from any thread.
+    //
+    // Every buffer it uses keeps its capacity between queries, so once a
+    // query of the same length has run, searching allocates nothing.
+    bool search(std::string_view input, uint64_t generation, uint32_t* ids, size_t capacity, size_t& count)
     {
+        count = 0;
         if (input.empty())
         {
-            return {};
+            return true;
         }
 
-        std::vector<std::string> matches;
+        // Smart case: a query without uppercase ignores case, by matching
+        // against the folded pool with exactly the same kernels
+        bool folded = CaseFold::is_folded(input);
+        const CandidatePool& pool = folded ? m_folded : m_candidates;
+        if (folded != m_query_folded)
+        {
+            m_query_depth = 0;
+            m_query_folded = folded;
+        }
 
-        // Collect all matches
-        for (const auto& word : m_all_words) 
+        size_t common = 0;
+        while (common < m_query_depth && common < input.size() && m_query[common] == input[common])
         {
-            if (is_subsequence(input, word)) 
+            ++common;
+        }
+
+        m_query.assign(input);
+        if (m_levels.size() < input.size())
+        {
+            m_levels.resize(input.size());
+        }
+
+        size_t chunks = (m_candidates.size() + kChunkSize - 1) / kChunkSize;
+        for (size_t depth = common; depth < input.size(); ++depth)
+        {
+            m_levels[depth].m_chunks.resize(chunks);
+        }
+
+        size_t limit = capacity;
+        if (m_chunk_tops.size() < chunks)
+        {
+            m_chunk_tops.resize(chunks);
+        }
+
+        const std::vector<int16_t>& bonus = frecency_bonus();
+
+        // Chunk c of every level only depends on chunk c of the level above,
+        // so each task narrows its chunk through all the new characters and
+        // ranks what is left of it on its own.
+        auto match_chunk = [&](size_t c)
+        {
+            TopK& top = m_chunk_tops[c];
+            top.reset(limit);
+
+            if (m_generation.load(std::memory_order_relaxed) != generation)
             {
-                matches.push_back(word);
+                return;
             }
+
+            for (size_t depth = common; depth < input.size(); ++depth)
+            {
+                QueryChunk& chunk = m_levels[depth].m_chunks[c];
+                chunk.m_candidates.clear();
+                chunk.m_resume.clear();
+
+                if (depth == 0)
+                {
+                    uint32_t first = static_cast<uint32_t>(c * kChunkSize);
+                    size_t count = std::min<size_t>(kChunkSize, m_candidates.size() - first);
+                    pool.narrow(input[depth], nullptr, nullptr, first, count, chunk.m_candidates, chunk.m_resume);
+                }
+                else
+                {
+                    const QueryChunk& previous = m_levels[depth - 1].m_chunks[c];
+                    pool.narrow(input[depth], previous.m_candidates.data(), previous.m_resume.data(), 0,
+                                previous.m_candidates.size(), chunk.m_candidates, chunk.m_resume);
+                }
+            }
+
+            const QueryChunk& survivors = m_levels[input.size() - 1].m_chunks[c];
+            for (size_t i = 0; i < survivors.m_candidates.size(); ++i)
+            {
+                uint32_t candidate = survivors.m_candidates[i];
+                std::string_view word = m_candidates.get(candidate);
+                int score = MatchScorer::score(input, pool.get(candidate), word, survivors.m_resume[i] - 1) + bonus[candidate];
+                top.offer({ score, static_cast<uint16_t>(word.size()), candidate });
+            }
+        };
+
+        if (scan_size(common) >= kParallelThreshold && m_search_threads > 1)
+        {
+            if (!m_search_pool)
+            {
+                m_search_pool = std::make_unique<ThreadPool>(m_search_threads - 1);
+            }
+            // By reference: wrapping the lambda itself would allocate
+            m_search_pool->parallelFor(chunks, std::cref(match_chunk));
         }
+        else
+        {
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                match_chunk(c);
+            }
+        }
+
+        // Some chunks may have bailed out: only the untouched levels are valid
+        if (m_generation.load(std::memory_order_relaxed) != generation)
+        {
+            m_query_depth = common;
+            return false;
+        }
+
+        m_query_depth = input.size();
 
-        // Sort matches by length (shorter matches first)
-        std::sort(matches.begin(), matches.end(), [](const std::string& a, const std::string& b) 
+        m_top.reset(limit);
+        for (size_t c = 0; c < chunks; ++c)
         {
-            return a.size() < b.size();
-        });
+            for (const auto& ranked : m_chunk_tops[c].sorted())
+            {
+                m_top.offer(ranked);
+            }
+        }
 
-        if (matches.size() > max_distance)
+        for (const auto& ranked : m_top.sorted())
         {
-            matches.resize(max_distance); 
+            ids[count++] = ranked.m_candidate;
         }
 
-        return matches;
+        return true;
+    }
+
+    // Aborts the search in flight, if any, and returns the new generation.
+    uint64_t cancel_search()
+    {
+        return m_generation.fetch_add(1, std::memory_order_relaxed) + 1;
     }
 
-    std::vector<std::string> get_best_matches(const std::string& input, int max_distance = 2) const
+    uint64_t search_generation() const
     {
-        std::vector<std::string> matches = get_fuzzy_matches(input, max_distance);
+        return m_generation.load(std::memory_order_relaxed);
+    }
 
-        // Additional filter: Ignore non-alphanumeric or single-character results
-        matches.erase(std::remove_if(matches.begin(), matches.end(),
-                                    [](const std::string& word)
-                                    {
-                                        return word.empty() || word.size() == 1 ||
-                                                std::none_of(word.begin(), word.end(), ::isalnum);
-                                    }),
-                    matches.end());
+    void set_search_threads(size_t threads)
+    {
+        m_search_threads = std::clamp<size_t>(threads, 1, kMaxSearchThreads);
+        m_search_pool.reset();
+    }
 
-        return matches;
+    std::vector<std::string> get_best_matches(const std::string& input, int max_distance = 2)
+    {
+        std::vector<uint32_t> ids(static_cast<size_t>(std::max(max_distance, 0)));
+        size_t count = 0;
+        get_best_matches(input, m_generation.load(std::memory_order_relaxed), ids.data(), ids.size(), count);
+        return to_names(ids.data(), count);
+    }
+
+    // Traced form of search(). add_word() already keeps out names that are
+    // too short or have nothing alphanumeric, so every id is a valid result.
+    bool get_best_matches(std::string_view input, uint64_t generation, uint32_t* ids, size_t capacity, size_t& count)
+    {
+        LatencyTracer::Scope trace(LatencyTracer::Stage::Match);
+        return search(input, generation, ids, capacity, count);
     }
 
 private:
@@ -208,20 +599,154 @@ private:
         return tokens;
     }
 
-    bool is_subsequence(const std::string& input, const std::string& word) const
+    std::vector<std::string> to_names(const uint32_t* ids, size_t count) const
+    {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < count; ++i)
+        {
+            names.emplace_back(m_candidates.get(ids[i]));
+        }
+        return names;
+    }
+
+    // Matched against the applications roots rather than m_desktop_dirs, so
+    // a directory that was gone at the last load still counts once it is back
+    static bool touches_desktop(const PathChanges& changes)
     {
-        size_t i = 0, j = 0;
-        while (i < input.size() && j < word.size()) 
+        std::vector<std::string> roots = DesktopEntries::directories();
+        auto under_root = [&roots](const std::string& path)
         {
-            if (input[i] == word[j]) 
+            return std::any_of(roots.begin(), roots.end(), [&path](const std::string& root)
             {
-                i++;
+                return path.compare(0, root.size(), root) == 0 &&
+                       (path.size() == root.size() || path[root.size()] == '/');
+            });
+        };
+
+        for (const auto& [path, names] : changes.m_changed)
+        {
+            if (under_root(path))
+            {
+                return true;
             }
-            j++;
         }
-        return i == input.size();
+        return std::any_of(changes.m_rescan.begin(), changes.m_rescan.end(), under_root);
+    }
+
+    bool indexed(std::string_view name) const
+    {
+        uint32_t id = m_candidates.find(name);
+        return id != CandidatePool::kNone && !m_candidates.removed(id);
+    }
+
+    // Entries are kept sorted for resolve(). The cache stores them that way,
+    // so a warm start only pays for the check. Returns true if they were not.
+    static bool sort_entries(PathDirectory& dir)
+    {
+        if (std::is_sorted(dir.m_entries.begin(), dir.m_entries.end()))
+        {
+            return false;
+        }
+
+        std::sort(dir.m_entries.begin(), dir.m_entries.end());
+        return true;
+    }
+
+    // Survivors of one query prefix within one chunk of the pool: the words
+    // that still contain it as a subsequence, and for each the offset just
+    // past its greedy match.
+    struct QueryChunk
+    {
+        std::vector<uint32_t> m_candidates;
+        std::vector<uint16_t> m_resume;
+    };
+
+    // m_levels[d] holds the survivors of the first d + 1 query characters.
+    // Only the characters past the prefix shared with the previous query cost
+    // anything: each narrows the level above, and deleting characters just
+    // drops levels without touching the corpus. The greedy leftmost match of a
+    // prefix is a valid start for matching any extension of it.
+    struct QueryLevel
+    {
+        std::vector<QueryChunk> m_chunks;
+    };
+
+    // How many candidates a search resuming after `depth` levels has to scan
+    size_t scan_size(size_t depth) const
+    {
+        if (depth == 0)
+        {
+            return m_candidates.size();
+        }
+
+        size_t total = 0;
+        for (const auto& chunk : m_levels[depth - 1].m_chunks)
+        {
+            total += chunk.m_candidates.size();
+        }
+        return total;
+    }
+
+    // Survivor lists and bonuses go stale whenever the corpus changes
+    void invalidate_query_cache()
+    {
+        m_query_depth = 0;
+        m_bonus.clear();
+    }
+
+    // The launch history bonus of every candidate, indexed like the pool.
+    // Rebuilt with one hash lookup per candidate after the corpus or the
+    // history changes, and hourly so that decay shows in a resident process.
+    const std::vector<int16_t>& frecency_bonus()
+    {
+        int64_t now = FrecencyStore::now();
+        if (m_bonus.size() == m_candidates.size() && now - m_bonus_time < 60 * 60)
+        {
+            return m_bonus;
+        }
+
+        m_bonus.assign(m_candidates.size(), 0);
+        m_bonus_time = now;
+        if (m_frecency.size() == 0)
+        {
+            return m_bonus;
+        }
+
+        std::string name;
+        for (uint32_t candidate = 0; candidate < m_candidates.size(); ++candidate)
+        {
+            name.assign(m_candidates.get(candidate));
+            m_bonus[candidate] = static_cast<int16_t>(MatchScorer::frecency_bonus(m_frecency.score(name, now)));
+        }
+
+        return m_bonus;
     }
 
-    std::unique_ptr<Trie> m_trie;
-    std::vector<std::string> m_all_words;
+    // The interned names; their ids are what searches return
+    CandidatePool m_candidates;
+
+    // The same names case-folded, under the same ids
+    CandidatePool m_folded;
+    mutable std::shared_mutex m_mutex;
+    std::vector<PathDirectory> m_dirs;
+
+    // Names from desktop entries, with their Exec lines
+    std::unordered_map<std::string, std::vector<std::string>> m_desktop;
+    // Every applications directory they were read from
+    std::vector<std::string> m_desktop_dirs;
+
+    std::string              m_query;
+    size_t                   m_query_depth;
+    bool                     m_query_folded;
+    std::vector<QueryLevel>  m_levels;
+    std::vector<TopK>        m_chunk_tops;
+    TopK                     m_top;
+    std::atomic<uint64_t>    m_generation;
+
+    FrecencyStore            m_frecency;
+    std::vector<int16_t>     m_bonus;
+    int64_t                  m_bonus_time;
+
+    size_t                       m_search_threads;
+    std::unique_ptr<ThreadPool>  m_search_pool;
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#pragma once
+
+#include "types.hpp"
+
+// Small fixed-size pool for fork/join style loops. The calling thread takes
+// part in every loop, so a pool of N workers runs N + 1 tasks at once.
+class ThreadPool final
+{
+public:
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs task(i) for every i in [0, count) and returns once all are done.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    size_t size() const;
+private:
+    void workerLoop();
+    void runTasks();
+private:
+    std::vector<std::thread>               m_workers;
+
+    std::mutex                             m_mutex;
+    std::condition_variable                m_wake;
+    std::condition_variable                m_done;
+    bool                                   m_stopping;
+    uint64_t                               m_job;
+    size_t                                 m_active;
+
+    const std::function<void(size_t)>*     m_task;
+    size_t                                 m_count;
+    std::atomic<size_t>                    m_next;
+};
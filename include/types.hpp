@@ -4,26 +4,56 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <list>
+#include <array>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <filesystem>
 #include <sstream>
 #include <algorithm>
 #include <limits>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
 
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h> 
+#include <errno.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <dirent.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/resource.h>
 #include <signal.h>
+#include <spawn.h>
+#include <elf.h>
 
 #include <stdlib.h>
 
 #include <xcb/xcb.h>
 #include <xcb/xinput.h>
 #include <xcb/xproto.h>
+#include <xcb/shm.h>
 
 #include <xcb/xcb_keysyms.h>
 #include <X11/keysym.h>
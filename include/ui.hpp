@@ -9,47 +9,115 @@
 #pragma once
 
 #include "types.hpp"
+#include "framebuffer.hpp"
+#include "layoutcache.hpp"
+#include "candidatepool.hpp"
+#include "latencytracer.hpp"
 
 #define M_PI 3.14159265358979323846
 #define M_PI_2 1.57079632679489661923
 
 class UI final
 {
+    static constexpr int kSuggestionsTop    = 40;
+    static constexpr int kSuggestionHeight  = 40;
+    static constexpr int kSuggestionSpacing = 5;
+
+    enum Atom
+    {
+        kNetWmWindowType,
+        kNetWmWindowTypeUtility,
+        kNetActiveWindow,
+        kNetWmState,
+        kNetWmStateSkipTaskbar,
+        kNetWmStateSkipPager,
+        kNetWmStateAbove,
+        kNetWmWindowOpacity,
+        kMotifWmHints,
+        kAtomCount
+    };
+
+    // What the window currently shows, as last drawn. Candidate ids stand
+    // for their names: one id never names anything else.
+    struct Frame
+    {
+        std::string               m_query;
+        std::vector<uint32_t>     m_suggestions;
+        ssize_t                   m_highlighted = -1;
+        bool                      m_valid = false;
+    };
 public:
-    UI() : m_connection(nullptr), m_screen(nullptr), m_font("Roboto 12"), 
+    UI() : m_connection(nullptr), m_screen(nullptr), m_net_active_window(XCB_ATOM_NONE), m_atoms_requested(false), m_font("Roboto 12"), 
         m_bgColor(0xFFFFFF), m_textColor(0x000000), m_highlightColor(0xFFAA00), 
-        m_draw_searbar_count(0), m_draw_suggestions_count(0)
+        m_searchBarSprite(nullptr), m_rowSprite(nullptr),
+        m_draw_searbar_count(0), m_draw_suggestions_count(0), m_buffered(false), m_present_all(false)
     {
     }
 
     ~UI()
     {
-        g_object_unref(m_pangoLayout);
+        destroySprites();
         cairo_destroy(m_cairoContext);
         cairo_surface_destroy(m_cairoSurface);
-        xcb_destroy_window(m_connection, m_window_id);
+        if (m_connection)
+        {
+            xcb_destroy_window(m_connection, m_window_id);
+        }
     }
 
-    void init(xcb_connection_t* connection, xcb_window_t window_id);
+    // Sends every request whose reply init() needs without waiting for any
+    // of them, so they complete while the caller builds the index.
+    void prefetch(xcb_connection_t* connection);
+    void init(xcb_connection_t* connection, xcb_window_t window_id, bool mapped = true);
+    // Renders into an image surface without any X connection (benchmarks)
+    void initHeadless(uint16_t width, uint16_t height);
+    void show();
+    void hide();
 
-    void drawUI(const std::string& query, const std::vector<std::string>& suggestions, size_t highlightedIndex);
-    void updateUI(std::string_view typedText, std::vector<std::string> suggestions, ssize_t highlightedIndex);
+    // Suggestions are candidate ids, looked up in `names` only to draw them
+    void drawUI(std::string_view query, const std::vector<uint32_t>& suggestions, const CandidatePool& names, size_t highlightedIndex);
+    void updateUI(std::string_view typedText, const std::vector<uint32_t>& suggestions, const CandidatePool& names, ssize_t highlightedIndex);
     void clearUI();
 
+    // Forgets what is on screen, so the next update repaints everything.
+    // Needed whenever the window contents were lost, e.g. on Expose.
+    void invalidate();
+
+    // Takes the events the UI itself asked for, such as the frame buffer's
+    // completions. Returns true if `event` was one of them.
+    bool handleEvent(const xcb_generic_event_t* event);
+
     void setFont(const std::string& fontDescription);
+    const LayoutCache& layoutCache() const;
     void setSourceColor(cairo_t* cr, uint32_t color);
 private:
-    void drawSearchBar(const std::string& query);
-    void drawSuggestions(const std::vector<std::string>& suggestions, size_t highlightedIndex);
-    void drawText(cairo_t* cr, int x, int y, const std::string& text, bool highlighted);
+    void drawSearchBar(std::string_view query);
+    void drawSuggestions(const std::vector<uint32_t>& suggestions, const CandidatePool& names, size_t highlightedIndex);
+    void drawSuggestion(size_t index, std::string_view suggestion, bool highlighted);
+    int  suggestionTop(size_t index) const;
+
+    // Backgrounds only depend on the window size: rasterized once, then
+    // composited per row.
+    void createSprites();
+    void destroySprites();
+    void repaintRegion(int y, int height, const std::function<void()>& draw);
+    void present(int y, int height);
+    void drawText(cairo_t* cr, int x, int y, std::string_view text, bool highlighted);
 
     xcb_visualtype_t* getVisualType(xcb_screen_t* screen);
 
-    void createWindow();
+    void createWindow(bool mapped);
+    void requestAtoms();
+    void collectAtoms();
 private:
     xcb_connection_t* m_connection;
     xcb_screen_t*     m_screen;
     xcb_window_t      m_window_id;
+    xcb_atom_t        m_net_active_window;
+
+    bool                                                m_atoms_requested;
+    std::array<xcb_intern_atom_cookie_t, kAtomCount>    m_atom_cookies;
+    std::array<xcb_atom_t, kAtomCount>                  m_atoms;
 
     uint16_t          m_window_width;
     uint16_t          m_window_height;
@@ -64,8 +132,21 @@ private:
     cairo_surface_t* m_cairoSurface;
     cairo_t* m_cairoContext;
 
-    PangoLayout* m_pangoLayout;
+    cairo_surface_t* m_searchBarSprite;
+    cairo_surface_t* m_rowSprite;
+
+    LayoutCache m_layoutCache;
+
+    // The search bar's text, reused from one keystroke to the next
+    std::string m_searchText;
 
     int m_draw_searbar_count;
     int m_draw_suggestions_count;
+
+    Frame m_frame;
+
+    // Set when frames are rasterized offscreen instead of on the window
+    bool        m_buffered;
+    bool        m_present_all;
+    FrameBuffer m_frameBuffer;
 };
\ No newline at end of file
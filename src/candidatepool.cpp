@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/candidatepool.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REX_X86 1
+#endif
+
+namespace
+{
+    struct NarrowArgs
+    {
+        const char*            bytes;
+        const uint32_t*        offsets;
+        const uint16_t*        lengths;
+        char                   ch;
+        const uint32_t*        candidates;
+        const uint16_t*        resume;
+        uint32_t               first;
+        size_t                 count;
+        std::vector<uint32_t>* out_candidates;
+        std::vector<uint16_t>* out_resume;
+    };
+
+    inline void keep(const NarrowArgs& args, uint32_t id, uint32_t found)
+    {
+        args.out_candidates->push_back(id);
+        args.out_resume->push_back(static_cast<uint16_t>(found + 1));
+    }
+
+    void narrowScalar(const NarrowArgs& args)
+    {
+        for (size_t i = 0; i < args.count; ++i)
+        {
+            uint32_t id = args.candidates ? args.candidates[i] : args.first + static_cast<uint32_t>(i);
+            const char* word = args.bytes + args.offsets[id];
+            uint32_t length = args.lengths[id];
+
+            for (uint32_t pos = args.resume ? args.resume[i] : 0; pos < length; ++pos)
+            {
+                if (word[pos] == args.ch)
+                {
+                    keep(args, id, pos);
+                    break;
+                }
+            }
+        }
+    }
+
+#ifdef REX_X86
+    __attribute__((target("sse2")))
+    void narrowSse2(const NarrowArgs& args)
+    {
+        const __m128i needle = _mm_set1_epi8(args.ch);
+
+        for (size_t i = 0; i < args.count; ++i)
+        {
+            uint32_t id = args.candidates ? args.candidates[i] : args.first + static_cast<uint32_t>(i);
+            const char* word = args.bytes + args.offsets[id];
+            uint32_t length = args.lengths[id];
+
+            // Loads may run past the word into its neighbours or the pool's
+            // padding; those lanes are masked off below.
+            for (uint32_t pos = args.resume ? args.resume[i] : 0; pos < length; pos += 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(word + pos));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+                uint32_t remaining = length - pos;
+                if (remaining < 16)
+                {
+                    mask &= (1u << remaining) - 1;
+                }
+
+                if (mask)
+                {
+                    keep(args, id, pos + __builtin_ctz(mask));
+                    break;
+                }
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void narrowAvx2(const NarrowArgs& args)
+    {
+        const __m256i needle = _mm256_set1_epi8(args.ch);
+
+        for (size_t i = 0; i < args.count; ++i)
+        {
+            uint32_t id = args.candidates ? args.candidates[i] : args.first + static_cast<uint32_t>(i);
+            const char* word = args.bytes + args.offsets[id];
+            uint32_t length = args.lengths[id];
+
+            for (uint32_t pos = args.resume ? args.resume[i] : 0; pos < length; pos += 32)
+            {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word + pos));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+                uint32_t remaining = length - pos;
+                if (remaining < 32)
+                {
+                    mask &= (1u << remaining) - 1;
+                }
+
+                if (mask)
+                {
+                    keep(args, id, pos + __builtin_ctz(mask));
+                    break;
+                }
+            }
+        }
+    }
+#endif
+
+    CandidatePool::Kernel detectKernel()
+    {
+#ifdef REX_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return CandidatePool::Kernel::Avx2;
+        }
+
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return CandidatePool::Kernel::Sse2;
+        }
+#endif
+        return CandidatePool::Kernel::Scalar;
+    }
+
+    std::atomic<CandidatePool::Kernel>& currentKernel()
+    {
+        static std::atomic<CandidatePool::Kernel> kernel(detectKernel());
+        return kernel;
+    }
+}
+
+void CandidatePool::clear()
+{
+    m_bytes.assign(kPadding, '\0');
+    m_offsets.clear();
+    m_lengths.clear();
+    m_index.clear();
+    m_interned = 0;
+}
+
+uint32_t CandidatePool::add(std::string_view word)
+{
+    size_t length = std::min<size_t>(word.size(), std::numeric_limits<uint16_t>::max());
+
+    // The padding always sits at the end: overwrite it and append it again.
+    size_t offset = m_bytes.size() - kPadding;
+    m_bytes.resize(offset + length + kPadding, '\0');
+    std::copy(word.begin(), word.begin() + length, m_bytes.begin() + offset);
+
+    m_offsets.push_back(static_cast<uint32_t>(offset));
+    m_lengths.push_back(static_cast<uint16_t>(length));
+    return static_cast<uint32_t>(m_offsets.size() - 1);
+}
+
+uint32_t CandidatePool::intern(std::string_view word)
+{
+    uint32_t id = find(word);
+    if (id != kNone)
+    {
+        return id;
+    }
+
+    if ((m_interned + 1) * 2 > m_index.size())
+    {
+        grow_index();
+    }
+
+    id = add(word);
+    size_t mask = m_index.size() - 1;
+    size_t slot = std::hash<std::string_view>()(get(id)) & mask;
+    while (m_index[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    m_index[slot] = id + 1;
+    ++m_interned;
+    return id;
+}
+
+uint32_t CandidatePool::find(std::string_view word) const
+{
+    if (m_index.empty())
+    {
+        return kNone;
+    }
+
+    size_t mask = m_index.size() - 1;
+    for (size_t slot = std::hash<std::string_view>()(word) & mask; m_index[slot] != 0; slot = (slot + 1) & mask)
+    {
+        uint32_t id = m_index[slot] - 1;
+        if (get(id) == word)
+        {
+            return id;
+        }
+    }
+    return kNone;
+}
+
+void CandidatePool::remove(uint32_t id)
+{
+    // Every kernel stops at the length, so nothing is compared any more
+    m_lengths[id] = 0;
+}
+
+void CandidatePool::restore(uint32_t id)
+{
+    m_lengths[id] = static_cast<uint16_t>(extent(id));
+}
+
+void CandidatePool::grow_index()
+{
+    std::vector<uint32_t> index(std::max<size_t>(64, m_index.size() * 2), 0);
+    size_t mask = index.size() - 1;
+
+    for (uint32_t entry : m_index)
+    {
+        if (entry == 0)
+        {
+            continue;
+        }
+
+        size_t slot = std::hash<std::string_view>()(get(entry - 1)) & mask;
+        while (index[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = entry;
+    }
+
+    m_index = std::move(index);
+}
+
+void CandidatePool::narrow(char ch, const uint32_t* candidates, const uint16_t* resume, uint32_t first, size_t count,
+                           std::vector<uint32_t>& out_candidates, std::vector<uint16_t>& out_resume) const
+{
+    // Survivors never outnumber the input, so this is the only growth.
+    out_candidates.reserve(count);
+    out_resume.reserve(count);
+
+    NarrowArgs args = { m_bytes.data(), m_offsets.data(), m_lengths.data(), ch, candidates, resume, first, count, &out_candidates, &out_resume };
+
+    switch (currentKernel().load(std::memory_order_relaxed))
+    {
+#ifdef REX_X86
+        case Kernel::Avx2:
+            narrowAvx2(args);
+            break;
+        case Kernel::Sse2:
+            narrowSse2(args);
+            break;
+#endif
+        default:
+            narrowScalar(args);
+            break;
+    }
+}
+
+bool CandidatePool::selectKernel(Kernel kernel)
+{
+#ifdef REX_X86
+    __builtin_cpu_init();
+    if ((kernel == Kernel::Avx2 && !__builtin_cpu_supports("avx2")) ||
+        (kernel == Kernel::Sse2 && !__builtin_cpu_supports("sse2")))
+    {
+        return false;
+    }
+#else
+    if (kernel != Kernel::Scalar)
+    {
+        return false;
+    }
+#endif
+
+    currentKernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+CandidatePool::Kernel CandidatePool::activeKernel()
+{
+    return currentKernel().load(std::memory_order_relaxed);
+}
+
+const char* CandidatePool::kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+        case Kernel::Avx2:
+            return "avx2";
+        case Kernel::Sse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
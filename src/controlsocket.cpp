@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/controlsocket.hpp"
+
+namespace
+{
+    bool fillAddress(const std::string& path, sockaddr_un& addr)
+    {
+        if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        {
+            return false;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+}
+
+bool ControlSocket::listen()
+{
+    m_path = socketPath();
+
+    sockaddr_un addr;
+    if (!fillAddress(m_path, addr))
+    {
+        logError("Invalid socket path: " + m_path);
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+    {
+        logError(std::string("Failed to create socket: ") + strerror(errno));
+        return false;
+    }
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        if (errno != EADDRINUSE)
+        {
+            logError("Failed to bind " + m_path + ": " + strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        // Either another daemon owns the socket or a dead one left it behind.
+        if (send(""))
+        {
+            logError("Another instance is already running");
+            close(fd);
+            return false;
+        }
+
+        unlink(m_path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            logError("Failed to bind " + m_path + ": " + strerror(errno));
+            close(fd);
+            return false;
+        }
+    }
+
+    if (::listen(fd, 8) < 0)
+    {
+        logError(std::string("Failed to listen: ") + strerror(errno));
+        close(fd);
+        unlink(m_path.c_str());
+        return false;
+    }
+
+    m_fd = fd;
+    return true;
+}
+
+int ControlSocket::fd() const
+{
+    return m_fd;
+}
+
+std::string ControlSocket::acceptCommand()
+{
+    int client = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0)
+    {
+        return {};
+    }
+
+    // Clients write their command right after connecting, so a short
+    // receive timeout keeps a misbehaving peer from stalling the UI.
+    timeval timeout = { 0, 100 * 1000 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char buffer[64];
+    ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+    close(client);
+
+    if (received <= 0)
+    {
+        return {};
+    }
+
+    std::string command(buffer, received);
+    size_t newline = command.find('\n');
+    if (newline != std::string::npos)
+    {
+        command.resize(newline);
+    }
+    return command;
+}
+
+bool ControlSocket::send(const std::string& command)
+{
+    sockaddr_un addr;
+    if (!fillAddress(socketPath(), addr))
+    {
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    std::string message = command + "\n";
+    bool sent = ::send(fd, message.data(), message.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(message.size());
+    close(fd);
+    return sent;
+}
+
+std::string ControlSocket::socketPath()
+{
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir)
+    {
+        return std::string(runtime_dir) + "/rex.sock";
+    }
+
+    return "/tmp/rex-" + std::to_string(getuid()) + ".sock";
+}
+
+void ControlSocket::logError(const std::string& error_message)
+{
+    std::cerr << "ControlSocket Error: " << error_message << std::endl;
+}
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/desktopentries.hpp"
+#include "../include/threadpool.hpp"
+
+namespace
+{
+    constexpr size_t kMaxParseThreads = 4;
+    // Guards against symlink loops among the subdirectories
+    constexpr int kMaxDepth = 8;
+    constexpr std::string_view kSuffix = ".desktop";
+
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    // The escapes of the spec's string type
+    std::string unescape(std::string_view value)
+    {
+        std::string result;
+        result.reserve(value.size());
+
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (value[i] != '\\' || i + 1 == value.size())
+            {
+                result += value[i];
+                continue;
+            }
+
+            switch (value[++i])
+            {
+                case 's':  result += ' ';  break;
+                case 'n':  result += '\n'; break;
+                case 't':  result += '\t'; break;
+                case 'r':  result += '\r'; break;
+                default:   result += value[i]; break;
+            }
+        }
+        return result;
+    }
+
+    bool isTrue(std::string_view value)
+    {
+        return value == "true";
+    }
+
+    // %f %F %u %U and friends stand for files or URLs we never pass
+    bool isFieldCode(char code)
+    {
+        return strchr("fFuUdDnNickvm", code) != nullptr;
+    }
+
+    // A directory of the applications tree and the prefix of the desktop file
+    // IDs found in it: applications/kde4/foo.desktop is kde4-foo.desktop
+    struct TreeDirectory
+    {
+        std::string m_path;
+        std::string m_prefix;
+    };
+
+    void collectTree(const std::string& path, const std::string& prefix, int depth, std::vector<TreeDirectory>& tree)
+    {
+        tree.push_back({ path, prefix });
+        if (depth == kMaxDepth)
+        {
+            return;
+        }
+
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return;
+        }
+
+        std::vector<std::string> subdirs;
+        while (dirent* entry = readdir(dir))
+        {
+            std::string_view name(entry->d_name);
+            if (name == "." || name == ".." || (entry->d_type != DT_DIR && entry->d_type != DT_LNK &&
+                                                entry->d_type != DT_UNKNOWN))
+            {
+                continue;
+            }
+
+            struct stat st;
+            std::string subdir = path + "/" + entry->d_name;
+            if (entry->d_type == DT_DIR || (stat(subdir.c_str(), &st) == 0 && S_ISDIR(st.st_mode)))
+            {
+                subdirs.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+
+        // Sorted, so which of two equal IDs wins does not depend on readdir
+        std::sort(subdirs.begin(), subdirs.end());
+        for (const auto& name : subdirs)
+        {
+            collectTree(path + "/" + name, prefix + name + "-", depth + 1, tree);
+        }
+    }
+
+    std::string stripFieldCodes(const std::string& arg)
+    {
+        std::string result;
+        for (size_t i = 0; i < arg.size(); ++i)
+        {
+            if (arg[i] == '%' && i + 1 < arg.size())
+            {
+                if (arg[i + 1] == '%')
+                {
+                    result += '%';
+                }
+                ++i;
+                continue;
+            }
+            result += arg[i];
+        }
+        return result;
+    }
+}
+
+std::vector<std::string> DesktopEntries::directories()
+{
+    std::vector<std::string> dirs;
+
+    const char* data_home = std::getenv("XDG_DATA_HOME");
+    const char* home = std::getenv("HOME");
+    if (data_home && *data_home)
+    {
+        dirs.push_back(std::string(data_home) + "/applications");
+    }
+    else if (home && *home)
+    {
+        dirs.push_back(std::string(home) + "/.local/share/applications");
+    }
+
+    const char* data_dirs = std::getenv("XDG_DATA_DIRS");
+    std::stringstream paths((data_dirs && *data_dirs) ? data_dirs : "/usr/local/share:/usr/share");
+    std::string path;
+    while (std::getline(paths, path, ':'))
+    {
+        if (!path.empty())
+        {
+            dirs.push_back(path + "/applications");
+        }
+    }
+
+    return dirs;
+}
+
+void DesktopEntries::load(std::vector<DesktopEntry>& entries, std::vector<std::string>& visited,
+                          const std::unordered_set<std::string>& changed)
+{
+    std::vector<TreeDirectory> tree;
+    for (const auto& path : directories())
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            collectTree(path, std::string(), 0, tree);
+        }
+    }
+
+    std::string cache_file = IndexCache::defaultPath("desktop.bin");
+    IndexCache cache;
+    if (!cache_file.empty())
+    {
+        cache.open(cache_file);
+    }
+
+    // Each subdirectory is cached on its own: its changes do not show in
+    // the mtime of its parent.
+    std::vector<PathDirectory> dirs;
+    std::vector<std::string> prefixes;
+    std::vector<size_t> stale;
+    std::vector<std::string_view> cached_records;
+
+    for (const auto& branch : tree)
+    {
+        struct stat st;
+        if (stat(branch.m_path.c_str(), &st) < 0 || !S_ISDIR(st.st_mode))
+        {
+            continue;
+        }
+
+        PathDirectory dir;
+        dir.m_path = branch.m_path;
+        dir.set_identity(st);
+
+        // Editing a file in place leaves the mtime of its directory alone
+        if (changed.count(branch.m_path) == 0 && cache.lookup(branch.m_path, st, cached_records))
+        {
+            dir.m_entries.assign(cached_records.begin(), cached_records.end());
+        }
+        else
+        {
+            stale.push_back(dirs.size());
+        }
+
+        dirs.push_back(std::move(dir));
+        prefixes.push_back(branch.m_prefix);
+    }
+
+    cache.close();
+
+    if (!stale.empty())
+    {
+        for (size_t index : stale)
+        {
+            scanDirectory(dirs[index].m_path, prefixes[index], dirs[index].m_entries);
+        }
+
+        if (!cache_file.empty())
+        {
+            IndexCache::write(cache_file, dirs);
+        }
+    }
+
+    // The first directory providing an ID wins, even to hide it
+    std::unordered_set<std::string_view> seen;
+    for (const auto& dir : dirs)
+    {
+        visited.push_back(dir.m_path);
+
+        for (const auto& record : dir.m_entries)
+        {
+            std::string_view id;
+            DesktopEntry entry;
+            if (!decode(record, id, entry) || !seen.insert(id).second || entry.m_name.empty())
+            {
+                continue;
+            }
+
+            entries.push_back(std::move(entry));
+        }
+    }
+}
+
+void DesktopEntries::scanDirectory(const std::string& path, const std::string& prefix, std::vector<std::string>& records)
+{
+    DIR* dir = opendir(path.c_str());
+    if (!dir)
+    {
+        logError("Error accessing directory '" + path + "': " + strerror(errno));
+        return;
+    }
+
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(dir))
+    {
+        std::string_view name(entry->d_name);
+        if (entry->d_type != DT_DIR && name.size() > kSuffix.size() &&
+            name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) == 0)
+        {
+            names.emplace_back(name);
+        }
+    }
+    closedir(dir);
+
+    // Sorted, so the cache does not change with readdir order
+    std::sort(names.begin(), names.end());
+    records.assign(names.size(), std::string());
+
+    size_t workers = std::min<size_t>({ names.size(), kMaxParseThreads, std::thread::hardware_concurrency() });
+    ThreadPool pool(workers > 1 ? workers - 1 : 0);
+
+    pool.parallelFor(names.size(), [&](size_t i)
+    {
+        // Unparsable and hidden files still shadow their ID
+        DesktopEntry entry;
+        if (!parseFile(path + "/" + names[i], entry))
+        {
+            entry = DesktopEntry();
+        }
+        records[i] = encode(prefix + names[i], entry);
+    });
+}
+
+bool DesktopEntries::parseFile(const std::string& path, DesktopEntry& entry)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    bool parsed = parse(std::string_view(static_cast<const char*>(data), st.st_size), entry);
+    munmap(data, st.st_size);
+    return parsed;
+}
+
+bool DesktopEntries::parse(std::string_view text, DesktopEntry& entry)
+{
+    std::string_view type;
+    std::string_view name;
+    std::string_view exec;
+    bool hidden = false;
+    bool in_group = false;
+
+    while (!text.empty())
+    {
+        size_t end = text.find('\n');
+        std::string_view line = trim(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        if (line.front() == '[')
+        {
+            // Everything we need comes before any other group
+            if (in_group)
+            {
+                break;
+            }
+            in_group = line == "[Desktop Entry]";
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (!in_group || equals == std::string_view::npos)
+        {
+            continue;
+        }
+
+        // Localized keys such as Name[de] do not compare equal
+        std::string_view key = trim(line.substr(0, equals));
+        std::string_view value = trim(line.substr(equals + 1));
+
+        if (key == "Type")
+        {
+            type = value;
+        }
+        else if (key == "Name")
+        {
+            name = value;
+        }
+        else if (key == "Exec")
+        {
+            exec = value;
+        }
+        else if (key == "Hidden" || key == "NoDisplay" || key == "Terminal")
+        {
+            hidden |= isTrue(value);
+        }
+    }
+
+    if (type != "Application" || hidden || name.empty() || exec.empty())
+    {
+        return false;
+    }
+
+    entry.m_name = unescape(name);
+    entry.m_argv = splitExec(exec);
+    return !entry.m_argv.empty();
+}
+
+std::vector<std::string> DesktopEntries::splitExec(std::string_view exec)
+{
+    // The value is a string first, then split by the quoting rules of Exec
+    std::string value = unescape(exec);
+
+    std::vector<std::string> args;
+    std::string current;
+    bool in_arg = false;
+    bool quoted = false;
+
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        char c = value[i];
+        if (quoted)
+        {
+            if (c == '\\' && i + 1 < value.size() && strchr("\"`$\\", value[i + 1]))
+            {
+                current += value[++i];
+            }
+            else if (c == '"')
+            {
+                quoted = false;
+            }
+            else
+            {
+                current += c;
+            }
+        }
+        else if (c == ' ' || c == '\t')
+        {
+            if (in_arg)
+            {
+                args.push_back(std::move(current));
+                current.clear();
+                in_arg = false;
+            }
+        }
+        else
+        {
+            quoted = c == '"';
+            if (!quoted)
+            {
+                current += c;
+            }
+            in_arg = true;
+        }
+    }
+
+    if (in_arg)
+    {
+        args.push_back(std::move(current));
+    }
+
+    std::vector<std::string> argv;
+    for (const auto& arg : args)
+    {
+        // A field code on its own stands for a whole argument
+        if (arg.size() == 2 && arg[0] == '%' && isFieldCode(arg[1]))
+        {
+            continue;
+        }
+        argv.push_back(stripFieldCodes(arg));
+    }
+    return argv;
+}
+
+std::string DesktopEntries::encode(std::string_view id, const DesktopEntry& entry)
+{
+    std::string record(id);
+    record += '\0';
+    record += entry.m_name;
+    for (const auto& arg : entry.m_argv)
+    {
+        record += '\0';
+        record += arg;
+    }
+    return record;
+}
+
+bool DesktopEntries::decode(std::string_view record, std::string_view& id, DesktopEntry& entry)
+{
+    size_t end = record.find('\0');
+    if (end == std::string_view::npos)
+    {
+        return false;
+    }
+
+    id = record.substr(0, end);
+    record.remove_prefix(end + 1);
+
+    end = record.find('\0');
+    entry.m_name.assign(record.substr(0, end));
+    while (end != std::string_view::npos)
+    {
+        record.remove_prefix(end + 1);
+        end = record.find('\0');
+        entry.m_argv.emplace_back(record.substr(0, end));
+    }
+
+    return entry.m_name.empty() || !entry.m_argv.empty();
+}
+
+void DesktopEntries::logError(const std::string& error_message)
+{
+    std::cerr << "DesktopEntries Error: " << error_message << std::endl;
+}
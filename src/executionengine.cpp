@@ -20,33 +20,70 @@ void ExecutionEngine::executeApplicationAndExit(const std::string& application,
 
 bool ExecutionEngine::executeApplication(const std::string& application, const std::vector<std::string>& args)
 {
-    pid_t pid = fork();
-    if (pid < 0) 
+    // The program sees its own name, not the path it was found at
+    size_t slash = application.rfind('/');
+    std::string name = slash == std::string::npos ? application : application.substr(slash + 1);
+
+    std::vector<char*> execArgs;
+    execArgs.push_back(const_cast<char*>(name.c_str()));
+    for (const auto& arg : args) 
     {
-        handleError("Fork failed!");
-        return false;
+        execArgs.push_back(const_cast<char*>(arg.c_str()));
     }
+    execArgs.push_back(nullptr);
 
-    if (pid == 0) 
-    {
-        std::vector<const char*> execArgs;
-        execArgs.push_back(application.c_str());
-        for (const auto& arg : args) 
-        {
-            execArgs.push_back(arg.c_str());
-        }
-        execArgs.push_back(nullptr);
+    // The child starts in a session of its own, so it outlives the launcher
+    // and its terminal, with default signal dispositions and nothing blocked.
+    // Every descriptor the launcher opens is close-on-exec.
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigfillset(&signals);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#endif
+    posix_spawnattr_setflags(&attributes, flags);
+
+    // glibc spawns with CLONE_VM | CLONE_VFORK: nothing of the launcher is
+    // copied, and a failing exec is reported here instead of in the child.
+    pid_t pid;
+    int error = slash != std::string::npos
+        ? posix_spawn(&pid, application.c_str(), nullptr, &attributes, execArgs.data(), environ)
+        : posix_spawnp(&pid, application.c_str(), nullptr, &attributes, execArgs.data(), environ);
 
-        execvp(application.c_str(), const_cast<char**>(execArgs.data()));
+    posix_spawnattr_destroy(&attributes);
 
-        // If execvp fails
-        handleError("Failed to execute application: " + application);
-        exit(-1);
+    if (error != 0)
+    {
+        handleError("Failed to execute application: " + application + ": " + strerror(error));
+        return false;
     }
 
     return true;
 }
 
+void ExecutionEngine::installChildReaper()
+{
+    struct sigaction action = {};
+    action.sa_handler = [](int)
+    {
+        int saved_errno = errno;
+        while (waitpid(-1, nullptr, WNOHANG) > 0)
+        {
+        }
+        errno = saved_errno;
+    };
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, nullptr);
+}
+
 void ExecutionEngine::handleError(const std::string& message)
 {
     std::cerr << "Execution Error: " << message << std::endl;
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/framebuffer.hpp"
+
+bool FrameBuffer::init(xcb_connection_t* connection, xcb_window_t window, const xcb_screen_t* screen, uint16_t width, uint16_t height)
+{
+    release();
+
+    m_connection = connection;
+    m_window = window;
+    m_width = width;
+    m_height = height;
+    m_depth = screen->root_depth;
+    m_stride = width * 4;
+
+    const xcb_setup_t* setup = xcb_get_setup(connection);
+    bool host_order = (setup->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST) == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+    bool packed = false;
+    for (xcb_format_iterator_t format = xcb_setup_pixmap_formats_iterator(setup); format.rem; xcb_format_next(&format))
+    {
+        if (format.data->depth == m_depth && format.data->bits_per_pixel == 32)
+        {
+            packed = true;
+        }
+    }
+
+    if (m_depth != 24 || !packed || !host_order || width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    m_gc = xcb_generate_id(connection);
+    xcb_create_gc(connection, m_gc, window, 0, nullptr);
+
+    if (!attachShm())
+    {
+        m_private.assign(static_cast<size_t>(m_stride) * height, 0);
+        m_data = m_private.data();
+    }
+
+    return true;
+}
+
+bool FrameBuffer::attachShm()
+{
+    const xcb_query_extension_reply_t* extension = xcb_get_extension_data(m_connection, &xcb_shm_id);
+    if (!extension || !extension->present)
+    {
+        return false;
+    }
+
+    m_shm_id = shmget(IPC_PRIVATE, static_cast<size_t>(m_stride) * m_height, IPC_CREAT | 0600);
+    if (m_shm_id < 0)
+    {
+        logError(std::string("shmget failed: ") + strerror(errno));
+        return false;
+    }
+
+    void* address = shmat(m_shm_id, nullptr, 0);
+    if (address == reinterpret_cast<void*>(-1))
+    {
+        logError(std::string("shmat failed: ") + strerror(errno));
+        shmctl(m_shm_id, IPC_RMID, nullptr);
+        m_shm_id = -1;
+        return false;
+    }
+
+    // A remote server cannot see the segment; it tells us with an error here
+    xcb_shm_seg_t segment = xcb_generate_id(m_connection);
+    xcb_generic_error_t* error = xcb_request_check(m_connection, xcb_shm_attach_checked(m_connection, segment, m_shm_id, 1));
+
+    // Either way the segment goes away once the last user detaches
+    shmctl(m_shm_id, IPC_RMID, nullptr);
+
+    if (error)
+    {
+        free(error);
+        shmdt(address);
+        m_shm_id = -1;
+        return false;
+    }
+
+    m_segment = segment;
+    m_completion_event = extension->first_event + XCB_SHM_COMPLETION;
+    m_data = static_cast<unsigned char*>(address);
+    return true;
+}
+
+void FrameBuffer::present(int y, int height)
+{
+    y = std::max(y, 0);
+    height = std::min(height, static_cast<int>(m_height) - y);
+    if (!m_data || height <= 0)
+    {
+        return;
+    }
+
+    if (m_segment)
+    {
+        // The server reads the rows straight out of the segment and sends a
+        // completion event once it is done with them
+        m_pending_put = xcb_shm_put_image(m_connection, m_window, m_gc, m_width, m_height, 0, y, m_width, height,
+                                          0, y, m_depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 1, m_segment, 0);
+        m_pending = true;
+    }
+    else
+    {
+        // Full-width bands are contiguous in the buffer; split them only to
+        // respect the server's maximum request size.
+        size_t max_bytes = static_cast<size_t>(xcb_get_maximum_request_length(m_connection)) * 4 - 64;
+        int rows_per_request = std::max<int>(1, static_cast<int>(max_bytes / m_stride));
+
+        for (int row = y; row < y + height; row += rows_per_request)
+        {
+            int rows = std::min(rows_per_request, y + height - row);
+            xcb_put_image(m_connection, XCB_IMAGE_FORMAT_Z_PIXMAP, m_window, m_gc, m_width, rows, 0, row, 0, m_depth,
+                          static_cast<uint32_t>(rows) * m_stride, m_data + static_cast<size_t>(row) * m_stride);
+        }
+    }
+
+    xcb_flush(m_connection);
+}
+
+void FrameBuffer::waitIdle()
+{
+    if (!m_pending)
+    {
+        return;
+    }
+
+    // Requests are handled in order: once a later one is answered, the put
+    // is done. Events arriving meanwhile stay queued in xcb for the loop.
+    m_pending = false;
+    free(xcb_get_input_focus_reply(m_connection, xcb_get_input_focus(m_connection), nullptr));
+}
+
+bool FrameBuffer::handleEvent(const xcb_generic_event_t* event)
+{
+    if (!m_segment || (event->response_type & ~0x80) != m_completion_event)
+    {
+        return false;
+    }
+
+    // A completion that arrives after waitIdle() already synced belongs to
+    // an older put and must not mark the current one done
+    if (event->sequence == static_cast<uint16_t>(m_pending_put.sequence))
+    {
+        m_pending = false;
+    }
+    return true;
+}
+
+void FrameBuffer::release()
+{
+    waitIdle();
+
+    if (m_segment)
+    {
+        xcb_shm_detach(m_connection, m_segment);
+        shmdt(m_data);
+        m_segment = 0;
+        m_shm_id = -1;
+    }
+
+    if (m_gc)
+    {
+        xcb_free_gc(m_connection, m_gc);
+        m_gc = 0;
+    }
+
+    m_private.clear();
+    m_data = nullptr;
+}
+
+void FrameBuffer::logError(const std::string& error_message)
+{
+    std::cerr << "FrameBuffer Error: " << error_message << std::endl;
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/frecencystore.hpp"
+
+namespace
+{
+    size_t align8(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    double decay(int64_t elapsed)
+    {
+        return std::exp2(-static_cast<double>(std::max<int64_t>(elapsed, 0)) / FrecencyStore::kHalfLife);
+    }
+
+    void appendRecord(std::string& buffer, const std::string& name, float weight, int64_t time)
+    {
+        FrecencyStore::Record record = {};
+        record.time = time;
+        record.weight = weight;
+        record.length = static_cast<uint16_t>(name.size());
+
+        buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        buffer += name;
+        buffer.resize(align8(buffer.size()), '\0');
+    }
+
+    bool writeAll(int fd, const std::string& buffer)
+    {
+        const char* data = buffer.data();
+        size_t remaining = buffer.size();
+        while (remaining > 0)
+        {
+            ssize_t written = ::write(fd, data, remaining);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            remaining -= written;
+        }
+        return true;
+    }
+}
+
+bool FrecencyStore::load(const std::string& file)
+{
+    m_file = file;
+    m_entries.clear();
+    m_records = 0;
+
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // Nothing launched yet
+        return errno == ENOENT;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return compact();
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        logError("Failed to map " + file + ": " + strerror(errno));
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    size_t size = st.st_size;
+    size_t offset = align8(sizeof(Header));
+
+    const Header* header = reinterpret_cast<const Header*>(bytes);
+    bool intact = size >= sizeof(Header) && header->magic == kMagic && header->version == kVersion;
+
+    while (intact && offset < size)
+    {
+        if (offset + sizeof(Record) > size)
+        {
+            intact = false;
+            break;
+        }
+
+        const Record* record = reinterpret_cast<const Record*>(bytes + offset);
+        size_t next = align8(offset + sizeof(Record) + record->length);
+        if (next > size || record->length == 0)
+        {
+            intact = false;
+            break;
+        }
+
+        apply(std::string(bytes + offset + sizeof(Record), record->length), record->weight, record->time);
+        offset = next;
+        ++m_records;
+    }
+
+    munmap(data, size);
+
+    // A torn append or a foreign file: keep what was readable and start over
+    // from a clean log, otherwise later appends would land misaligned.
+    if (!intact)
+    {
+        logError("Rewriting damaged launch log " + file);
+        return compact();
+    }
+
+    if (m_records >= kCompactAfter)
+    {
+        compact();
+    }
+
+    return true;
+}
+
+void FrecencyStore::record(const std::string& name)
+{
+    if (name.empty() || name.size() > std::numeric_limits<uint16_t>::max())
+    {
+        return;
+    }
+
+    int64_t time = now();
+    apply(name, 1.0, time);
+
+    if (m_file.empty())
+    {
+        return;
+    }
+
+    if (++m_records >= kCompactAfter || !append(name, 1.0f, time))
+    {
+        compact();
+    }
+}
+
+double FrecencyStore::score(const std::string& name, int64_t now) const
+{
+    auto entry = m_entries.find(name);
+    if (entry == m_entries.end())
+    {
+        return 0.0;
+    }
+
+    return entry->second.m_score * decay(now - entry->second.m_time);
+}
+
+void FrecencyStore::apply(const std::string& name, double weight, int64_t time)
+{
+    auto inserted = m_entries.emplace(name, Entry{ weight, time });
+    if (inserted.second)
+    {
+        return;
+    }
+
+    // Scores are kept as of the latest launch; older records decay into it.
+    Entry& entry = inserted.first->second;
+    if (time >= entry.m_time)
+    {
+        entry.m_score = entry.m_score * decay(time - entry.m_time) + weight;
+        entry.m_time = time;
+    }
+    else
+    {
+        entry.m_score += weight * decay(entry.m_time - time);
+    }
+}
+
+bool FrecencyStore::append(const std::string& name, float weight, int64_t time)
+{
+    // Without O_CREAT: a missing log needs its header, which compact() writes.
+    int fd = ::open(m_file.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // One write() per record, so appends from concurrent instances never interleave
+    std::string buffer;
+    appendRecord(buffer, name, weight, time);
+    bool written = writeAll(fd, buffer);
+    ::close(fd);
+
+    if (!written)
+    {
+        logError("Failed to append to " + m_file + ": " + strerror(errno));
+    }
+    return written;
+}
+
+bool FrecencyStore::compact()
+{
+    if (m_file.empty())
+    {
+        return false;
+    }
+
+    int64_t time = now();
+    for (auto entry = m_entries.begin(); entry != m_entries.end(); )
+    {
+        if (entry->second.m_score * decay(time - entry->second.m_time) < kForgetBelow)
+        {
+            entry = m_entries.erase(entry);
+        }
+        else
+        {
+            ++entry;
+        }
+    }
+
+    Header header = { kMagic, kVersion };
+    std::string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer.resize(align8(buffer.size()), '\0');
+    for (const auto& entry : m_entries)
+    {
+        appendRecord(buffer, entry.first, static_cast<float>(entry.second.m_score), entry.second.m_time);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_file).parent_path(), ec);
+
+    std::string tmp = m_file + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        logError("Failed to create " + tmp + ": " + strerror(errno));
+        return false;
+    }
+
+    if (!writeAll(fd, buffer))
+    {
+        logError("Failed to write " + tmp + ": " + strerror(errno));
+        ::close(fd);
+        unlink(tmp.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    if (rename(tmp.c_str(), m_file.c_str()) < 0)
+    {
+        logError("Failed to replace " + m_file + ": " + strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    m_records = m_entries.size();
+    return true;
+}
+
+int64_t FrecencyStore::now()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string FrecencyStore::defaultPath()
+{
+    const char* data_home = std::getenv("XDG_DATA_HOME");
+    if (data_home && *data_home)
+    {
+        return std::string(data_home) + "/rex/launches.log";
+    }
+
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+    {
+        return std::string(home) + "/.local/share/rex/launches.log";
+    }
+
+    return {};
+}
+
+void FrecencyStore::logError(const std::string& error_message)
+{
+    std::cerr << "FrecencyStore Error: " << error_message << std::endl;
+}
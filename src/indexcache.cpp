@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/indexcache.hpp"
+
+namespace
+{
+    size_t align8(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    template <typename T>
+    void appendRecord(std::string& buffer, const T& record)
+    {
+        buffer.append(reinterpret_cast<const char*>(&record), sizeof(T));
+    }
+}
+
+bool IndexCache::open(const std::string& file)
+{
+    close();
+
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // A missing cache is the normal first-run case, not an error.
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        logError("Failed to map " + file + ": " + strerror(errno));
+        return false;
+    }
+
+    m_data = static_cast<const char*>(data);
+    m_size = st.st_size;
+    m_header = reinterpret_cast<const Header*>(m_data);
+
+    if (!validate())
+    {
+        logError("Ignoring stale or corrupt index " + file);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void IndexCache::close()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_dirs = nullptr;
+    m_words = nullptr;
+    m_pool = nullptr;
+}
+
+bool IndexCache::validate()
+{
+    if (m_header->magic != kMagic || m_header->version != kVersion)
+    {
+        return false;
+    }
+
+    size_t dirs_offset = align8(sizeof(Header));
+    size_t words_offset = align8(dirs_offset + sizeof(DirRecord) * static_cast<size_t>(m_header->dir_count));
+    size_t pool_offset = align8(words_offset + sizeof(WordRecord) * static_cast<size_t>(m_header->word_count));
+
+    if (pool_offset + m_header->pool_size != m_size)
+    {
+        return false;
+    }
+
+    m_dirs = reinterpret_cast<const DirRecord*>(m_data + dirs_offset);
+    m_words = reinterpret_cast<const WordRecord*>(m_data + words_offset);
+    m_pool = m_data + pool_offset;
+
+    for (uint32_t i = 0; i < m_header->dir_count; ++i)
+    {
+        const DirRecord& dir = m_dirs[i];
+        if (static_cast<uint64_t>(dir.path_offset) + dir.path_length > m_header->pool_size ||
+            static_cast<uint64_t>(dir.first_word) + dir.word_count > m_header->word_count)
+        {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_header->word_count; ++i)
+    {
+        if (static_cast<uint64_t>(m_words[i].offset) + m_words[i].length > m_header->pool_size)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool IndexCache::lookup(const std::string& path, const struct stat& st, std::vector<std::string_view>& entries) const
+{
+    if (!m_header)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_header->dir_count; ++i)
+    {
+        const DirRecord& dir = m_dirs[i];
+        if (poolString(dir.path_offset, dir.path_length) != path)
+        {
+            continue;
+        }
+
+        if (dir.device != static_cast<uint64_t>(st.st_dev) || dir.inode != static_cast<uint64_t>(st.st_ino) ||
+            dir.mtime_sec != st.st_mtim.tv_sec || dir.mtime_nsec != st.st_mtim.tv_nsec)
+        {
+            return false;
+        }
+
+        entries.clear();
+        entries.reserve(dir.word_count);
+        for (uint32_t w = dir.first_word; w < dir.first_word + dir.word_count; ++w)
+        {
+            entries.push_back(poolString(m_words[w].offset, m_words[w].length));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+std::string_view IndexCache::poolString(uint32_t offset, uint32_t length) const
+{
+    return std::string_view(m_pool + offset, length);
+}
+
+bool IndexCache::write(const std::string& file, const std::vector<PathDirectory>& dirs)
+{
+    std::string pool;
+    std::vector<DirRecord> dir_records;
+    std::vector<WordRecord> word_records;
+
+    auto intern = [&pool](const std::string& str)
+    {
+        WordRecord record = { static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(str.size()) };
+        pool += str;
+        return record;
+    };
+
+    for (const auto& dir : dirs)
+    {
+        WordRecord path = intern(dir.m_path);
+
+        DirRecord record = {};
+        record.path_offset = path.offset;
+        record.path_length = path.length;
+        record.device = dir.m_device;
+        record.inode = dir.m_inode;
+        record.mtime_sec = dir.m_mtime_sec;
+        record.mtime_nsec = dir.m_mtime_nsec;
+        record.first_word = static_cast<uint32_t>(word_records.size());
+        record.word_count = static_cast<uint32_t>(dir.m_entries.size());
+        dir_records.push_back(record);
+
+        for (const auto& entry : dir.m_entries)
+        {
+            word_records.push_back(intern(entry));
+        }
+    }
+
+    if (pool.size() > std::numeric_limits<uint32_t>::max())
+    {
+        logError("Index too large to cache");
+        return false;
+    }
+
+    Header header = {};
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.dir_count = static_cast<uint32_t>(dir_records.size());
+    header.word_count = static_cast<uint32_t>(word_records.size());
+    header.pool_size = pool.size();
+
+    std::string buffer;
+    appendRecord(buffer, header);
+    buffer.resize(align8(buffer.size()), '\0');
+    for (const auto& record : dir_records)
+    {
+        appendRecord(buffer, record);
+    }
+    buffer.resize(align8(buffer.size()), '\0');
+    for (const auto& record : word_records)
+    {
+        appendRecord(buffer, record);
+    }
+    buffer.resize(align8(buffer.size()), '\0');
+    buffer += pool;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+
+    // Write to a private temporary and rename it over the old index so that a
+    // concurrently starting instance never maps a half-written file.
+    std::string tmp = file + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        logError("Failed to create " + tmp + ": " + strerror(errno));
+        return false;
+    }
+
+    const char* data = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            logError("Failed to write " + tmp + ": " + strerror(errno));
+            ::close(fd);
+            unlink(tmp.c_str());
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    ::close(fd);
+
+    if (rename(tmp.c_str(), file.c_str()) < 0)
+    {
+        logError("Failed to replace " + file + ": " + strerror(errno));
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+std::string IndexCache::defaultPath(const std::string& name)
+{
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home)
+    {
+        return std::string(cache_home) + "/rex/" + name;
+    }
+
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+    {
+        return std::string(home) + "/.cache/rex/" + name;
+    }
+
+    return {};
+}
+
+void IndexCache::logError(const std::string& error_message)
+{
+    std::cerr << "IndexCache Error: " << error_message << std::endl;
+}
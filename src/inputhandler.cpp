@@ -8,7 +8,7 @@
 
 #include "../include/inputhandler.hpp"
 
-bool InputHandler::init(xcb_connection_t* connection, xcb_window_t window_id, ssize_t max_suggeestions)
+bool InputHandler::init(xcb_connection_t* connection, xcb_window_t window_id, ssize_t max_suggeestions, bool resident)
 {
     if (xcb_connection_has_error(connection))
     {
@@ -19,6 +19,8 @@ bool InputHandler::init(xcb_connection_t* connection, xcb_window_t window_id, ss
     m_window_id = window_id;
     m_setup = xcb_get_setup(connection);
 
+    // Both keymap fetches only send their request here. They are answered
+    // while the index is built and collected afterwards.
     m_key_symbols = xcb_key_symbols_alloc(m_connection);
     if (!m_key_symbols) 
     {
@@ -33,6 +35,15 @@ bool InputHandler::init(xcb_connection_t* connection, xcb_window_t window_id, ss
     m_num_keycodes = m_last_keycode - m_first_keycode + 1;
     m_keysyms.resize(m_num_keycodes);
 
+    m_mapping_cookie = xcb_get_keyboard_mapping(m_connection, m_first_keycode, m_num_keycodes);
+    xcb_flush(m_connection);
+
+    {
+        LatencyTracer::Scope trace(LatencyTracer::Stage::PathScan);
+        m_suggestions.populate_from_path();
+        m_suggestions.populate_from_desktop_entries();
+    }
+
     // Fetch the keyboard mapping only once at initialization
     if (!loadKeyMapping())
     {
@@ -40,22 +51,131 @@ bool InputHandler::init(xcb_connection_t* connection, xcb_window_t window_id, ss
         return false;
     }
 
-    m_suggestions.populate_from_path();
+    // The key symbols table waits for its reply on first use; take it now
+    // rather than on the first key press.
+    xcb_key_symbols_get_keysym(m_key_symbols, m_first_keycode, 0);
+
     m_max_suggestion = max_suggeestions;
+    m_resident = resident;
+
+    if (!m_search.start())
+    {
+        logError("Failed to start the search worker.");
+        return false;
+    }
+
+    // Only an optimization: launching works the same without it. Whatever
+    // Return would launch, if it is a program of its own.
+    m_prefetcher.start([this](uint32_t candidate)
+    {
+        std::shared_lock<std::shared_mutex> lock = m_suggestions.read_lock();
+        std::vector<std::string> command = m_suggestions.command(std::string(m_suggestions.name(candidate)));
+        return !command.empty() && command[0][0] == '/' ? command[0] : std::string();
+    });
 
     return true;
 }
 
-std::string_view InputHandler::processEvents(xcb_generic_event_t* event)
+bool InputHandler::processEvents(xcb_generic_event_t* event)
 {
     if (((event->response_type) & ~0x80) == XCB_KEY_PRESS) 
     {
         xcb_key_press_event_t* key_event = reinterpret_cast<xcb_key_press_event_t*>(event);
-        processKeyPress(key_event);
+        return processKeyPress(key_event);
+    }
+
+    // Focus, crossing and button events change nothing
+    return false;
+}
+
+void InputHandler::flushSearch()
+{
+    if (m_search_dirty)
+    {
+        m_search_dirty = false;
+        requestSuggestions();
+    }
+}
+
+void InputHandler::reset()
+{
+    m_inputBuffer.clear();
+    m_text_suggestions.clear();
+    m_suggestion_index = 0;
+    m_dismiss_requested = false;
+
+    m_search.cancel();
+    m_search_pending = false;
+    m_search_dirty = false;
+    updatePrefetch();
+}
+
+bool InputHandler::consumeDismissRequest()
+{
+    bool requested = m_dismiss_requested;
+    m_dismiss_requested = false;
+    return requested;
+}
+
+std::vector<std::string> InputHandler::watchedDirectories() const
+{
+    // Only read before the first request reaches the worker
+    return m_suggestions.directories();
+}
+
+void InputHandler::applyPathChanges(const PathChanges& changes)
+{
+    m_search.applyPathChanges(changes);
+
+    if (!m_inputBuffer.empty())
+    {
+        requestSuggestions();
+    }
+}
+
+int InputHandler::searchResultFd() const
+{
+    return m_search.resultFd();
+}
+
+bool InputHandler::takeSearchResults()
+{
+    if (!m_search.takeResults(m_text_suggestions))
+    {
+        return false;
+    }
+
+    m_search_pending = false;
+    m_suggestion_index = std::clamp<ssize_t>(m_suggestion_index, 0, std::max<ssize_t>(0, m_text_suggestions.size() - 1));
+    updatePrefetch();
+    return true;
+}
+
+bool InputHandler::searchPending() const
+{
+    return m_search_pending || m_search_dirty;
+}
+
+void InputHandler::updatePrefetch()
+{
+    // Whatever Return would launch right now
+    bool selected = m_suggestion_index >= 0 && m_suggestion_index < static_cast<ssize_t>(m_text_suggestions.size());
+    m_prefetcher.select(selected ? m_text_suggestions[m_suggestion_index] : Prefetcher::kNoSelection);
+}
+
+void InputHandler::requestSuggestions()
+{
+    if (m_inputBuffer.empty())
+    {
+        m_search.cancel();
+        m_search_pending = false;
+        m_text_suggestions.clear();
+        updatePrefetch();
+        return;
     }
 
-    // Return the current state of the input buffer
-    return std::string_view(m_inputBuffer);
+    m_search.search(m_inputBuffer, m_max_suggestion);
+    m_search_pending = true;
 }
 
 char InputHandler::mapKeysymToChar(xcb_keysym_t keysym)
@@ -76,8 +196,10 @@ char InputHandler::mapKeysymToChar(xcb_keysym_t keysym)
     }
 }
 
-void InputHandler::processKeyPress(xcb_key_press_event_t* k_event)
+bool InputHandler::processKeyPress(xcb_key_press_event_t* k_event)
 {
+    LatencyTracer::Scope trace(LatencyTracer::Stage::KeyPress);
+
     xcb_keycode_t keycode = k_event->detail;
     
     // Determine active modifiers
@@ -90,26 +212,86 @@ void InputHandler::processKeyPress(xcb_key_press_event_t* k_event)
     {
         case XK_Return:
         {
-            m_exec_engine.executeApplicationAndExit(m_text_suggestions[m_suggestion_index], {});
-            break;
+            // Launch what the typed text matches, not what an older prefix did
+            flushSearch();
+            if (m_search_pending)
+            {
+                m_search.waitForResults(m_text_suggestions);
+                m_search_pending = false;
+                m_suggestion_index = 0;
+            }
+
+            if (m_text_suggestions.empty() || m_suggestion_index < 0 ||
+                m_suggestion_index >= static_cast<ssize_t>(m_text_suggestions.size()))
+            {
+                return true;
+            }
+
+            // Names the index cannot place are left to a $PATH lookup
+            std::string application;
+            std::vector<std::string> command;
+            {
+                std::shared_lock<std::shared_mutex> lock = m_suggestions.read_lock();
+                application = m_suggestions.name(m_text_suggestions[m_suggestion_index]);
+                command = m_suggestions.command(application);
+            }
+
+            if (command.empty())
+            {
+                command.push_back(application);
+            }
+
+            std::string program = std::move(command.front());
+            std::vector<std::string> args(std::make_move_iterator(command.begin() + 1), std::make_move_iterator(command.end()));
+            m_prefetcher.launched(program);
+            if (m_resident)
+            {
+                // Stay alive with everything warm and just get out of the way
+                m_dismiss_requested = m_exec_engine.executeApplication(program, args);
+                if (m_dismiss_requested)
+                {
+                    m_search.recordLaunch(application);
+                }
+            }
+            else if (m_exec_engine.executeApplication(program, args))
+            {
+                // About to exit: take the index back to record synchronously
+                m_search.stop();
+                m_suggestions.record_launch(application);
+                exit(0);
+            }
+            return true;
         }
         case XK_BackSpace:
         {
-            if (!m_inputBuffer.empty()) 
+            if (m_inputBuffer.empty()) 
             {
-                m_inputBuffer.pop_back();
-                m_text_suggestions = m_suggestions.get_best_matches(m_inputBuffer, m_max_suggestion);
-                m_suggestion_index = 0;
+                return false;
             }
-            break;
+
+            m_inputBuffer.pop_back();
+            m_search_dirty = true;
+            m_suggestion_index = 0;
+            return true;
         }
         case XK_Escape:
         {
+            if (m_resident)
+            {
+                m_dismiss_requested = true;
+                return false;
+            }
+
             exit(0);
-            break;
         }
         case XK_Up:
         {
+            if (m_text_suggestions.empty())
+            {
+                return false;
+            }
+
+            ssize_t previous = m_suggestion_index;
             if (m_suggestion_index == 0)
             {
                 if (m_max_suggestion > m_text_suggestions.size())
@@ -125,10 +307,17 @@ void InputHandler::processKeyPress(xcb_key_press_event_t* k_event)
             {
                 --m_suggestion_index;
             }
-            break;
+            updatePrefetch();
+            return m_suggestion_index != previous;
         }
         case XK_Down:
         {
+            if (m_text_suggestions.empty())
+            {
+                return false;
+            }
+
+            ssize_t previous = m_suggestion_index;
             if (m_suggestion_index == (m_max_suggestion - 1))
             {
                 m_suggestion_index = 0;
@@ -141,28 +330,30 @@ void InputHandler::processKeyPress(xcb_key_press_event_t* k_event)
             {
                 ++m_suggestion_index;
             }
-            break;
+            updatePrefetch();
+            return m_suggestion_index != previous;
         }
         default:
         {
-            // Convert the keysym to a character and append it
+            // Convert the keysym to a character and append it. Modifiers and
+            // other keys without one leave everything as it was.
             char ch = mapKeysymToChar(keysym);
-            if (ch != '\0') 
+            if (ch == '\0') 
             {
-                m_inputBuffer += ch;
+                return false;
             }
 
-            m_text_suggestions = m_suggestions.get_best_matches(m_inputBuffer, m_max_suggestion);
+            m_inputBuffer += ch;
+            m_search_dirty = true;
             m_suggestion_index = 0;
-            break;
+            return true;
         }
     }
 }
 
 bool InputHandler::loadKeyMapping()
 {
-    xcb_get_keyboard_mapping_cookie_t cookie = xcb_get_keyboard_mapping(m_connection, m_first_keycode, m_num_keycodes);
-    m_reply = xcb_get_keyboard_mapping_reply(m_connection, cookie, nullptr);
+    m_reply = xcb_get_keyboard_mapping_reply(m_connection, m_mapping_cookie, nullptr);
 
     if (!m_reply) 
     {
@@ -191,11 +382,26 @@ void InputHandler::logError(const std::string& error_message)
     std::cerr << "InputHandler Error: " << error_message << std::endl;
 }
 
-std::vector<std::string>& InputHandler::getSuggestions()
+std::string_view InputHandler::getInputText() const
+{
+    return m_inputBuffer;
+}
+
+const std::vector<uint32_t>& InputHandler::getSuggestions() const
 {
     return m_text_suggestions;
 }
 
+const CandidatePool& InputHandler::getNames() const
+{
+    return m_suggestions.names();
+}
+
+std::shared_lock<std::shared_mutex> InputHandler::lockNames() const
+{
+    return m_suggestions.read_lock();
+}
+
 ssize_t InputHandler::getIndexSuggestion() const
 {
     return m_suggestion_index;
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/latencytracer.hpp"
+
+namespace
+{
+    constexpr size_t kStageCount = static_cast<size_t>(LatencyTracer::Stage::Count);
+    constexpr size_t kCounterCount = static_cast<size_t>(LatencyTracer::Counter::Count);
+
+    // Values below 2^kSubBucketBits ns are counted exactly; above, every
+    // power of two is split into 2^kSubBucketBits linear buckets.
+    constexpr unsigned kSubBucketBits = 5;
+    constexpr size_t   kSubBuckets = size_t(1) << kSubBucketBits;
+    constexpr size_t   kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    // A run that never exits would otherwise grow without bound
+    constexpr size_t   kMaxEvents = 1 << 20;
+
+    // Written by the event loop and the search worker alike
+    struct Histogram
+    {
+        std::array<std::atomic<uint64_t>, kBuckets> m_counts = {};
+        std::atomic<uint64_t>                       m_total{0};
+        std::atomic<uint64_t>                       m_max{0};
+
+        static size_t bucket(uint64_t value)
+        {
+            if (value < kSubBuckets)
+            {
+                return value;
+            }
+
+            unsigned exponent = 63 - __builtin_clzll(value);
+            size_t sub = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+            return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+        }
+
+        // Smallest value counted in `index`
+        static uint64_t lowest(size_t index)
+        {
+            if (index < kSubBuckets)
+            {
+                return index;
+            }
+
+            unsigned exponent = index / kSubBuckets + kSubBucketBits - 1;
+            return (kSubBuckets + index % kSubBuckets) << (exponent - kSubBucketBits);
+        }
+
+        void add(uint64_t value)
+        {
+            m_counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            m_total.fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t max = m_max.load(std::memory_order_relaxed);
+            while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        uint64_t percentile(double fraction) const
+        {
+            uint64_t total = m_total.load(std::memory_order_relaxed);
+            uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total)));
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i)
+            {
+                seen += m_counts[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                {
+                    return lowest(i);
+                }
+            }
+            return m_max.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct Event
+    {
+        LatencyTracer::Stage m_stage;
+        pid_t                m_thread;
+        uint64_t             m_start;
+        uint64_t             m_end;
+    };
+
+    struct State
+    {
+        std::string               m_output;
+        uint64_t                  m_origin = 0;
+        std::array<Histogram, kStageCount> m_histograms;
+        std::array<std::atomic<uint64_t>, kCounterCount> m_counters = {};
+
+        std::mutex                m_mutex;
+        std::vector<Event>        m_events;
+    };
+
+    State& state()
+    {
+        static State* instance = new State();  // Still alive for atexit()
+        return *instance;
+    }
+
+    pid_t currentThread()
+    {
+        static thread_local pid_t id = static_cast<pid_t>(syscall(SYS_gettid));
+        return id;
+    }
+
+    void printDuration(std::ostream& out, uint64_t ns)
+    {
+        char text[32];
+        snprintf(text, sizeof(text), "%10.1f us", ns / 1000.0);
+        out << text;
+    }
+}
+
+void LatencyTracer::initFromEnvironment()
+{
+    const char* output = std::getenv("REX_TRACE");
+    if (!output || !*output)
+    {
+        return;
+    }
+
+    State& tracer = state();
+    tracer.m_output = output;
+    tracer.m_origin = now();
+    tracer.m_events.reserve(4096);
+
+    s_enabled.store(true, std::memory_order_relaxed);
+    std::atexit(report);
+}
+
+uint64_t LatencyTracer::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec) + 1;
+}
+
+void LatencyTracer::record(Stage stage, uint64_t start, uint64_t end)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    State& tracer = state();
+    tracer.m_histograms[static_cast<size_t>(stage)].add(end - start);
+
+    std::lock_guard<std::mutex> lock(tracer.m_mutex);
+    if (tracer.m_events.size() < kMaxEvents)
+    {
+        tracer.m_events.push_back({ stage, currentThread(), start, end });
+    }
+}
+
+void LatencyTracer::count(Counter counter, uint64_t amount)
+{
+    if (enabled())
+    {
+        state().m_counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+}
+
+void LatencyTracer::report()
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    State& tracer = state();
+
+    std::cerr << "Latency per stage:\n";
+    for (size_t i = 0; i < kStageCount; ++i)
+    {
+        const Histogram& histogram = tracer.m_histograms[i];
+        uint64_t count = histogram.m_total.load(std::memory_order_relaxed);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        char label[48];
+        snprintf(label, sizeof(label), "  %-18s %8llu  p50", stageName(static_cast<Stage>(i)), static_cast<unsigned long long>(count));
+        std::cerr << label;
+        printDuration(std::cerr, histogram.percentile(0.50));
+        std::cerr << "  p99";
+        printDuration(std::cerr, histogram.percentile(0.99));
+        std::cerr << "  max";
+        printDuration(std::cerr, histogram.m_max.load(std::memory_order_relaxed));
+        std::cerr << "\n";
+    }
+
+    for (size_t i = 0; i < kCounterCount; ++i)
+    {
+        uint64_t value = tracer.m_counters[i].load(std::memory_order_relaxed);
+        if (value > 0)
+        {
+            std::cerr << "  " << counterName(static_cast<Counter>(i)) << ": " << value << "\n";
+        }
+    }
+
+    // Read ahead for a selection that was then not launched
+    uint64_t prefetched = tracer.m_counters[static_cast<size_t>(Counter::PrefetchBytes)].load(std::memory_order_relaxed);
+    uint64_t used = tracer.m_counters[static_cast<size_t>(Counter::PrefetchHitBytes)].load(std::memory_order_relaxed);
+    if (prefetched > 0)
+    {
+        std::cerr << "  prefetch_wasted_bytes: " << (prefetched - std::min(prefetched, used)) << "\n";
+    }
+
+    FILE* file = fopen(tracer.m_output.c_str(), "w");
+    if (!file)
+    {
+        logError("Failed to write " + tracer.m_output + ": " + strerror(errno));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(tracer.m_mutex);
+
+    // Complete ("X") events, timestamps in microseconds
+    fprintf(file, "{\"traceEvents\":[");
+    for (size_t i = 0; i < tracer.m_events.size(); ++i)
+    {
+        const Event& event = tracer.m_events[i];
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"rex\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                i ? "," : "", stageName(event.m_stage), static_cast<int>(getpid()), static_cast<int>(event.m_thread),
+                (event.m_start - tracer.m_origin) / 1000.0, (event.m_end - event.m_start) / 1000.0);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    fclose(file);
+
+    // A second report would only repeat this one
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+const char* LatencyTracer::stageName(Stage stage)
+{
+    switch (stage)
+    {
+        case Stage::Connect:         return "connect";
+        case Stage::PathScan:        return "path_scan";
+        case Stage::FontInit:        return "font_init";
+        case Stage::FirstFrame:      return "first_frame";
+        case Stage::KeyPress:        return "key_press";
+        case Stage::Match:           return "match";
+        case Stage::DrawSearchBar:   return "draw_search_bar";
+        case Stage::DrawSuggestions: return "draw_suggestions";
+        case Stage::Present:         return "present";
+        case Stage::Keystroke:       return "keystroke";
+        default:                     return "unknown";
+    }
+}
+
+const char* LatencyTracer::counterName(Counter counter)
+{
+    switch (counter)
+    {
+        case Counter::Prefetches:       return "prefetches";
+        case Counter::PrefetchBytes:    return "prefetch_bytes";
+        case Counter::PrefetchHits:     return "prefetch_hits";
+        case Counter::PrefetchHitBytes: return "prefetch_hit_bytes";
+        default:                        return "unknown";
+    }
+}
+
+void LatencyTracer::logError(const std::string& error_message)
+{
+    std::cerr << "LatencyTracer Error: " << error_message << std::endl;
+}
@@ -8,8 +8,36 @@
 
 #include "../include/rex.hpp"
 
-int main()
+int main(int argc, char* argv[])
 {
-    Rex rex;
+    LatencyTracer::initFromEnvironment();
+
+    bool resident = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+
+        if (arg == "--daemon")
+        {
+            resident = true;
+        }
+        else if (arg == "--show")
+        {
+            // Hand off to a running daemon; without one, fall back to a
+            // regular one-shot launcher.
+            if (ControlSocket::send("show"))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--daemon | --show]\n";
+            return 1;
+        }
+    }
+
+    Rex rex(resident);
     rex.runEventLoop();
 }
\ No newline at end of file
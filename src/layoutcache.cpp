@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/layoutcache.hpp"
+
+LayoutCache::~LayoutCache()
+{
+    clear();
+
+    if (m_font)
+    {
+        pango_font_description_free(m_font);
+    }
+}
+
+void LayoutCache::setFont(const std::string& font_description)
+{
+    clear();
+
+    if (m_font)
+    {
+        pango_font_description_free(m_font);
+    }
+    m_font = pango_font_description_from_string(font_description.c_str());
+}
+
+PangoLayout* LayoutCache::get(cairo_t* cr, std::string_view text)
+{
+    auto found = m_index.find(text);
+    if (found != m_index.end())
+    {
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        return found->second->m_layout;
+    }
+
+    ++m_misses;
+
+    PangoLayout* layout = pango_cairo_create_layout(cr);
+    if (m_font)
+    {
+        pango_layout_set_font_description(layout, m_font);
+    }
+    pango_layout_set_text(layout, text.data(), static_cast<int>(text.size()));
+
+    m_entries.push_front(Entry{ std::string(text), layout });
+    m_index.emplace(m_entries.front().m_text, m_entries.begin());
+    m_bytes += text.size();
+
+    evict();
+    return layout;
+}
+
+void LayoutCache::clear()
+{
+    for (auto& entry : m_entries)
+    {
+        g_object_unref(entry.m_layout);
+    }
+
+    m_entries.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+void LayoutCache::evict()
+{
+    // Never the entry just added, which the caller is about to draw
+    while (m_entries.size() > 1 && (m_entries.size() > kMaxEntries || m_bytes > kMaxBytes))
+    {
+        Entry& oldest = m_entries.back();
+        m_index.erase(oldest.m_text);
+        m_bytes -= oldest.m_text.size();
+        g_object_unref(oldest.m_layout);
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/pathscanner.hpp"
+#include "../include/threadpool.hpp"
+
+namespace
+{
+    struct LinuxDirent64
+    {
+        uint64_t       d_ino;
+        int64_t        d_off;
+        unsigned short d_reclen;
+        unsigned char  d_type;
+        char           d_name[NAME_MAX + 1];
+    };
+
+    constexpr size_t kMaxScanThreads = 4;
+
+    bool isExecutableMode(const struct stat& st)
+    {
+        return S_ISREG(st.st_mode) && (st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) != 0;
+    }
+}
+
+void PathScanner::scan(const std::vector<std::string>& directories, std::vector<std::vector<std::string>>& entries)
+{
+    entries.clear();
+    entries.resize(directories.size());
+
+    size_t workers = std::min<size_t>({ directories.size(), kMaxScanThreads, std::thread::hardware_concurrency() });
+    ThreadPool pool(workers > 1 ? workers - 1 : 0);
+
+    pool.parallelFor(directories.size(), [&](size_t i)
+    {
+        scanDirectory(directories[i], entries[i]);
+    });
+}
+
+bool PathScanner::scanDirectory(const std::string& path, std::vector<std::string>& entries)
+{
+    int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0)
+    {
+        logError("Error accessing directory '" + path + "': " + strerror(errno));
+        return false;
+    }
+
+    alignas(LinuxDirent64) char buffer[64 * 1024];
+
+    while (true)
+    {
+        long length = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+        if (length < 0)
+        {
+            logError("Error reading directory '" + path + "': " + strerror(errno));
+            close(dir_fd);
+            return false;
+        }
+
+        if (length == 0)
+        {
+            break;
+        }
+
+        for (long offset = 0; offset < length; )
+        {
+            const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            {
+                continue;
+            }
+
+            // Anything but a regular file or a symlink to one can be ruled out
+            // from d_type alone. Permissions still need a stat.
+            if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)
+            {
+                continue;
+            }
+
+            struct stat st;
+            if (fstatat(dir_fd, name, &st, 0) == 0 && isExecutableMode(st))
+            {
+                entries.emplace_back(name);
+            }
+        }
+    }
+
+    close(dir_fd);
+    return true;
+}
+
+bool PathScanner::isExecutable(const std::string& dir, const std::string& name)
+{
+    struct stat st;
+    std::string path = dir + "/" + name;
+    return stat(path.c_str(), &st) == 0 && isExecutableMode(st);
+}
+
+void PathScanner::logError(const std::string& error_message)
+{
+    std::cerr << "PathScanner Error: " << error_message << std::endl;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/pathwatcher.hpp"
+
+bool PathWatcher::watch(const std::vector<std::string>& directories)
+{
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd < 0)
+    {
+        logError(std::string("inotify_init1 failed: ") + strerror(errno));
+        return false;
+    }
+
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd < 0)
+    {
+        logError(std::string("timerfd_create failed: ") + strerror(errno));
+        return false;
+    }
+
+    for (const auto& directory : directories)
+    {
+        if (addWatch(directory))
+        {
+            continue;
+        }
+
+        // Not there yet; watched once it is created
+        if (errno == ENOENT)
+        {
+            m_lost.insert(directory);
+            continue;
+        }
+
+        logError("Cannot watch " + directory + ": " + strerror(errno));
+    }
+
+    if (!m_lost.empty())
+    {
+        armRetry();
+    }
+
+    return true;
+}
+
+bool PathWatcher::addWatch(const std::string& directory)
+{
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_CLOSE_WRITE |
+                          IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+    int wd = inotify_add_watch(m_inotify_fd, directory.c_str(), mask);
+    if (wd < 0)
+    {
+        return false;
+    }
+
+    m_watches[wd] = directory;
+    return true;
+}
+
+void PathWatcher::rewatchLost()
+{
+    for (auto directory = m_lost.begin(); directory != m_lost.end(); )
+    {
+        // Whatever it held before is gone; all of the new one is news
+        if (addWatch(*directory))
+        {
+            m_pending.m_rescan.insert(*directory);
+            directory = m_lost.erase(directory);
+        }
+        else
+        {
+            ++directory;
+        }
+    }
+}
+
+int PathWatcher::inotifyFd() const
+{
+    return m_inotify_fd;
+}
+
+int PathWatcher::timerFd() const
+{
+    return m_timer_fd;
+}
+
+void PathWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+    bool received = false;
+
+    while (true)
+    {
+        ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            received = true;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // Events were dropped; only a full rescan is trustworthy now.
+                for (const auto& [wd, directory] : m_watches)
+                {
+                    m_pending.m_rescan.insert(directory);
+                }
+                continue;
+            }
+
+            auto watch = m_watches.find(event->wd);
+            if (watch == m_watches.end())
+            {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                // A moved directory keeps its watch wherever it went; drop
+                // it, since only what is at the path matters. Its IN_IGNORED
+                // then finds no watch any more.
+                if (event->mask & IN_MOVE_SELF)
+                {
+                    inotify_rm_watch(m_inotify_fd, event->wd);
+                }
+
+                m_pending.m_rescan.insert(watch->second);
+                if (event->mask & (IN_MOVE_SELF | IN_IGNORED))
+                {
+                    m_lost.insert(watch->second);
+                    m_watches.erase(watch);
+                }
+                continue;
+            }
+
+            if (event->len > 0 && !(event->mask & IN_ISDIR))
+            {
+                m_pending.m_changed[watch->second].insert(event->name);
+            }
+        }
+    }
+
+    if (received && !m_pending.empty())
+    {
+        armTimer();
+    }
+}
+
+void PathWatcher::armTimer()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!m_batch_open)
+    {
+        m_batch_open = true;
+        m_batch_start = now;
+    }
+
+    // Every new event pushes the deadline out, but never past kMaxDelay from
+    // the first event of the batch.
+    auto deadline = std::min(now + kQuietPeriod, m_batch_start + kMaxDelay);
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+    if (remaining.count() <= 0)
+    {
+        remaining = std::chrono::nanoseconds(1);
+    }
+
+    itimerspec spec = {};
+    spec.it_value.tv_sec = remaining.count() / 1000000000;
+    spec.it_value.tv_nsec = remaining.count() % 1000000000;
+    timerfd_settime(m_timer_fd, 0, &spec, nullptr);
+}
+
+void PathWatcher::armRetry()
+{
+    // Nothing tells us when a lost directory comes back, so look again later
+    itimerspec spec = {};
+    spec.it_value.tv_sec = kRetryPeriod.count();
+    timerfd_settime(m_timer_fd, 0, &spec, nullptr);
+}
+
+bool PathWatcher::takeChanges(PathChanges& changes)
+{
+    uint64_t expirations;
+    if (read(m_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+    {
+        return false;
+    }
+
+    m_batch_open = false;
+    rewatchLost();
+
+    if (!m_lost.empty())
+    {
+        armRetry();
+    }
+
+    if (m_pending.empty())
+    {
+        return false;
+    }
+
+    changes = std::move(m_pending);
+    m_pending.clear();
+    return true;
+}
+
+void PathWatcher::logError(const std::string& error_message)
+{
+    std::cerr << "PathWatcher Error: " << error_message << std::endl;
+}
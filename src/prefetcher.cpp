@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/prefetcher.hpp"
+
+namespace
+{
+#if defined(__LP64__)
+    using ElfHeader = Elf64_Ehdr;
+    using ElfProgramHeader = Elf64_Phdr;
+    using ElfDynamic = Elf64_Dyn;
+    constexpr unsigned char kElfClass = ELFCLASS64;
+#else
+    using ElfHeader = Elf32_Ehdr;
+    using ElfProgramHeader = Elf32_Phdr;
+    using ElfDynamic = Elf32_Dyn;
+    constexpr unsigned char kElfClass = ELFCLASS32;
+#endif
+
+#if defined(__x86_64__)
+    constexpr const char* kMultiarch = "x86_64-linux-gnu";
+#elif defined(__aarch64__)
+    constexpr const char* kMultiarch = "aarch64-linux-gnu";
+#elif defined(__i386__)
+    constexpr const char* kMultiarch = "i386-linux-gnu";
+#else
+    constexpr const char* kMultiarch = nullptr;
+#endif
+
+    // A read-only mapping of a whole file
+    struct MappedFile
+    {
+        int         m_fd = -1;
+        void*       m_data = MAP_FAILED;
+        size_t      m_size = 0;
+
+        explicit MappedFile(const std::string& path)
+        {
+            m_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (m_fd < 0 || fstat(m_fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+            {
+                return;
+            }
+
+            m_size = static_cast<size_t>(st.st_size);
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        }
+
+        ~MappedFile()
+        {
+            if (m_data != MAP_FAILED)
+            {
+                munmap(m_data, m_size);
+            }
+
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+            }
+        }
+
+        bool valid() const
+        {
+            return m_data != MAP_FAILED;
+        }
+
+        const char* bytes() const
+        {
+            return static_cast<const char*>(m_data);
+        }
+    };
+
+    // The DT_NEEDED names of an ELF object, and its DT_RUNPATH or DT_RPATH
+    // directories. Only objects of the launcher's own class are understood.
+    void readDynamic(const MappedFile& file, std::vector<std::string>& needed, std::vector<std::string>& runpath)
+    {
+        if (file.m_size < sizeof(ElfHeader))
+        {
+            return;
+        }
+
+        const ElfHeader* header = reinterpret_cast<const ElfHeader*>(file.bytes());
+        if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != kElfClass ||
+            header->e_phoff + static_cast<size_t>(header->e_phnum) * sizeof(ElfProgramHeader) > file.m_size)
+        {
+            return;
+        }
+
+        const ElfProgramHeader* segments = reinterpret_cast<const ElfProgramHeader*>(file.bytes() + header->e_phoff);
+
+        // DT_STRTAB holds a virtual address; the PT_LOAD containing it gives
+        // the file offset.
+        auto toOffset = [&](uint64_t address) -> uint64_t
+        {
+            for (size_t i = 0; i < header->e_phnum; ++i)
+            {
+                const ElfProgramHeader& segment = segments[i];
+                if (segment.p_type == PT_LOAD && address >= segment.p_vaddr && address - segment.p_vaddr < segment.p_filesz)
+                {
+                    return address - segment.p_vaddr + segment.p_offset;
+                }
+            }
+            return file.m_size;
+        };
+
+        for (size_t i = 0; i < header->e_phnum; ++i)
+        {
+            const ElfProgramHeader& segment = segments[i];
+            if (segment.p_type != PT_DYNAMIC || segment.p_offset + segment.p_filesz > file.m_size)
+            {
+                continue;
+            }
+
+            const ElfDynamic* entries = reinterpret_cast<const ElfDynamic*>(file.bytes() + segment.p_offset);
+            size_t count = segment.p_filesz / sizeof(ElfDynamic);
+
+            uint64_t strtab = file.m_size;
+            std::vector<uint64_t> needed_names;
+            uint64_t runpath_name = std::numeric_limits<uint64_t>::max();
+
+            for (size_t e = 0; e < count && entries[e].d_tag != DT_NULL; ++e)
+            {
+                switch (entries[e].d_tag)
+                {
+                    case DT_STRTAB:
+                        strtab = toOffset(entries[e].d_un.d_ptr);
+                        break;
+                    case DT_NEEDED:
+                        needed_names.push_back(entries[e].d_un.d_val);
+                        break;
+                    case DT_RUNPATH:
+                    case DT_RPATH:
+                        runpath_name = entries[e].d_un.d_val;
+                        break;
+                }
+            }
+
+            auto string = [&](uint64_t offset) -> std::string
+            {
+                if (strtab >= file.m_size || offset >= file.m_size - strtab)
+                {
+                    return {};
+                }
+
+                const char* begin = file.bytes() + strtab + offset;
+                return std::string(begin, strnlen(begin, file.m_size - strtab - offset));
+            };
+
+            for (uint64_t name : needed_names)
+            {
+                needed.push_back(string(name));
+            }
+
+            if (runpath_name != std::numeric_limits<uint64_t>::max())
+            {
+                std::stringstream paths(string(runpath_name));
+                std::string path;
+                while (std::getline(paths, path, ':'))
+                {
+                    runpath.push_back(path);
+                }
+            }
+            return;
+        }
+    }
+
+    // Reads the parts of a file that are not in the page cache yet and
+    // returns how many bytes that was.
+    uint64_t warm(const MappedFile& file)
+    {
+        if (!file.valid())
+        {
+            return 0;
+        }
+
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t pages = (file.m_size + page - 1) / page;
+        std::vector<unsigned char> resident(pages);
+        if (mincore(file.m_data, file.m_size, resident.data()) < 0)
+        {
+            resident.assign(pages, 0);
+        }
+
+        uint64_t cold = 0;
+        for (size_t i = 0; i < pages; ++i)
+        {
+            if (!(resident[i] & 1))
+            {
+                cold += std::min(page, file.m_size - i * page);
+            }
+        }
+
+        if (cold > 0 && readahead(file.m_fd, 0, file.m_size) < 0)
+        {
+            posix_fadvise(file.m_fd, 0, file.m_size, POSIX_FADV_WILLNEED);
+        }
+        return cold;
+    }
+
+    void lowerPriority()
+    {
+        // Both apply to the calling thread only
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+
+        constexpr int kIoprioWhoProcess = 1;
+        constexpr int kIoprioClassIdle = 3;
+        constexpr int kIoprioClassShift = 13;
+        syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+    }
+}
+
+bool Prefetcher::start(Resolver resolve)
+{
+    m_resolve = std::move(resolve);
+
+    // Where the dynamic linker looks after DT_RUNPATH
+    const char* library_path = std::getenv("LD_LIBRARY_PATH");
+    if (library_path)
+    {
+        std::stringstream paths(library_path);
+        std::string path;
+        while (std::getline(paths, path, ':'))
+        {
+            if (!path.empty())
+            {
+                m_search_dirs.push_back(path);
+            }
+        }
+    }
+
+    if (kMultiarch)
+    {
+        m_search_dirs.push_back(std::string("/lib/") + kMultiarch);
+        m_search_dirs.push_back(std::string("/usr/lib/") + kMultiarch);
+    }
+
+    for (const char* dir : { "/lib64", "/usr/lib64", "/lib", "/usr/lib", "/usr/local/lib" })
+    {
+        m_search_dirs.push_back(dir);
+    }
+
+    try
+    {
+        m_thread = std::thread(&Prefetcher::run, this);
+    }
+    catch (const std::system_error& error)
+    {
+        logError(std::string("Failed to start the prefetch thread: ") + error.what());
+        return false;
+    }
+    return true;
+}
+
+void Prefetcher::stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void Prefetcher::select(uint32_t candidate)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (candidate == m_selection)
+        {
+            return;
+        }
+
+        m_selection = candidate;
+        m_selection_time = std::chrono::steady_clock::now();
+    }
+    m_wake.notify_one();
+}
+
+void Prefetcher::launched(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!path.empty() && path == m_prefetched_path)
+    {
+        LatencyTracer::count(LatencyTracer::Counter::PrefetchHits, 1);
+        LatencyTracer::count(LatencyTracer::Counter::PrefetchHitBytes, m_prefetched_bytes);
+    }
+}
+
+void Prefetcher::run()
+{
+    lowerPriority();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        // Sleep until the selection changes, then until it has held still
+        // for the whole debounce
+        m_wake.wait(lock, [this] { return m_stopping || (m_selection != kNoSelection && m_selection != m_prefetched); });
+        if (m_stopping)
+        {
+            return;
+        }
+
+        auto due = m_selection_time + kDebounce;
+        if (std::chrono::steady_clock::now() < due)
+        {
+            m_wake.wait_until(lock, due);
+            continue;
+        }
+
+        uint32_t candidate = m_selection;
+        m_prefetched = candidate;
+        m_prefetched_path.clear();
+        m_prefetched_bytes = 0;
+
+        lock.unlock();
+        std::string path = m_resolve ? m_resolve(candidate) : std::string();
+        lock.lock();
+
+        // Names without a program of their own are nothing to read ahead
+        if (path.empty() || m_prefetched != candidate)
+        {
+            continue;
+        }
+
+        m_prefetched_path = path;
+        LatencyTracer::count(LatencyTracer::Counter::Prefetches, 1);
+
+        lock.unlock();
+        uint64_t bytes = prefetch(candidate, path);
+        lock.lock();
+
+        LatencyTracer::count(LatencyTracer::Counter::PrefetchBytes, bytes);
+        if (m_prefetched == candidate)
+        {
+            m_prefetched_bytes = bytes;
+        }
+    }
+}
+
+uint64_t Prefetcher::prefetch(uint32_t candidate, const std::string& path)
+{
+    uint64_t bytes = 0;
+    for (const auto& file : dependencies(path))
+    {
+        // A new selection wins over the rest of this one
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping || m_selection != candidate)
+            {
+                break;
+            }
+        }
+
+        bytes += warm(MappedFile(file));
+    }
+    return bytes;
+}
+
+const std::vector<std::string>& Prefetcher::dependencies(const std::string& path)
+{
+    auto cached = m_dependencies.find(path);
+    if (cached != m_dependencies.end())
+    {
+        return cached->second;
+    }
+
+    // Breadth first from the binary; every file is listed once
+    std::vector<std::string> files = { path };
+    std::unordered_set<std::string> seen = { path };
+
+    for (size_t i = 0; i < files.size() && files.size() < kMaxFiles; ++i)
+    {
+        std::vector<std::string> needed;
+        std::vector<std::string> runpath;
+        {
+            MappedFile file(files[i]);
+            if (!file.valid())
+            {
+                continue;
+            }
+            readDynamic(file, needed, runpath);
+        }
+
+        std::string origin = files[i].substr(0, files[i].rfind('/'));
+        for (auto& dir : runpath)
+        {
+            if (dir.compare(0, 7, "$ORIGIN") == 0)
+            {
+                dir = origin + dir.substr(7);
+            }
+        }
+
+        for (const auto& name : needed)
+        {
+            if (name.empty())
+            {
+                continue;
+            }
+
+            std::string resolved;
+            if (name.find('/') != std::string::npos)
+            {
+                resolved = name;
+            }
+            else
+            {
+                for (const auto* dirs : { &runpath, &m_search_dirs })
+                {
+                    for (const auto& dir : *dirs)
+                    {
+                        std::string candidate = dir + "/" + name;
+                        if (access(candidate.c_str(), R_OK) == 0)
+                        {
+                            resolved = std::move(candidate);
+                            break;
+                        }
+                    }
+
+                    if (!resolved.empty())
+                    {
+                        break;
+                    }
+                }
+            }
+
+            if (!resolved.empty() && seen.insert(resolved).second)
+            {
+                files.push_back(std::move(resolved));
+            }
+        }
+    }
+
+    return m_dependencies.emplace(path, std::move(files)).first->second;
+}
+
+void Prefetcher::logError(const std::string& error_message)
+{
+    std::cerr << "Prefetcher Error: " << error_message << std::endl;
+}
@@ -10,26 +10,218 @@
 
 void Rex::init()
 {
-    m_connection = xcb_connect(nullptr, nullptr);
+    if (m_resident)
+    {
+        if (!m_control.listen())
+        {
+            std::cerr << "Could not start resident instance\nProcess Aborted\n";
+            exit(-1);
+        }
+
+        ExecutionEngine::installChildReaper();
+    }
+
+    {
+        LatencyTracer::Scope trace(LatencyTracer::Stage::Connect);
+        m_connection = xcb_connect(nullptr, nullptr);
+    }
 
     if(xcb_connection_has_error(m_connection))
     {
         std::cerr << "Could not connect to X server\nProcess Aborted\n";
         exit(-1);
     }
+
+    // Launched applications must not inherit the connection
+    fcntl(xcb_get_file_descriptor(m_connection), F_SETFD, FD_CLOEXEC);
 }
 
 void Rex::runEventLoop()
 {
     xcb_generic_event_t *event;
 
-    m_ui.drawUI("", {}, 0);
-    while ((event = xcb_wait_for_event(m_connection))) 
+    if (m_visible)
+    {
+        LatencyTracer::Scope trace(LatencyTracer::Stage::FirstFrame);
+        m_ui.drawUI("", {}, m_inputHandler.getNames(), 0);
+    }
+
+    // The control socket and the watcher are -1 unless resident, which
+    // poll() skips.
+    pollfd fds[5] = {};
+    fds[0].fd = xcb_get_file_descriptor(m_connection);
+    fds[1].fd = m_control.fd();
+    fds[2].fd = m_watcher.inotifyFd();
+    fds[3].fd = m_watcher.timerFd();
+    fds[4].fd = m_inputHandler.searchResultFd();
+    for (auto& fd : fds)
+    {
+        fd.events = POLLIN;
+    }
+
+    // An event xcb read off the socket while waiting for a reply
+    xcb_generic_event_t* queued = nullptr;
+
+    while (!xcb_connection_has_error(m_connection)) 
+    {
+        // Apply everything already queued, then search and draw once for the
+        // whole batch: a burst of typing or key repeat costs one frame.
+        bool redraw = false;
+        uint64_t wakeup = LatencyTracer::enabled() ? LatencyTracer::now() : 0;
+        while ((event = queued ? queued : xcb_poll_for_event(m_connection)))
+        {
+            queued = nullptr;
+            redraw |= handleEvent(event);
+            free(event);
+        }
+
+        // A keystroke is timed until the frame showing its final results
+        if (redraw && wakeup && !m_input_time)
+        {
+            m_input_time = wakeup;
+        }
+
+        m_inputHandler.flushSearch();
+        if (redraw && m_visible)
+        {
+            render();
+        }
+
+        // Drawing may have waited for a reply, and xcb then reads whatever
+        // came before it into its own queue, where poll() cannot see it
+        queued = xcb_poll_for_queued_event(m_connection);
+        if (queued)
+        {
+            continue;
+        }
+
+        if (poll(fds, 5, -1) < 0)
+        {
+            // Interrupted by SIGCHLD from a reaped launch
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            std::cerr << "poll failed: " << strerror(errno) << "\nProcess Aborted\n";
+            break;
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            handleCommand(m_control.acceptCommand());
+        }
+
+        if (fds[2].revents & POLLIN)
+        {
+            m_watcher.readEvents();
+        }
+
+        if (fds[3].revents & POLLIN)
+        {
+            handlePathChanges();
+        }
+
+        if (fds[4].revents & POLLIN)
+        {
+            handleSearchResults();
+        }
+    }
+}
+
+bool Rex::handleEvent(xcb_generic_event_t* event)
+{
+    if (m_ui.handleEvent(event))
+    {
+        return false;
+    }
+
+    bool changed = m_inputHandler.processEvents(event);
+
+    if (m_inputHandler.consumeDismissRequest())
+    {
+        hide();
+        return false;
+    }
+
+    // The window contents are gone: the last Expose of a series triggers a
+    // full frame.
+    if ((event->response_type & ~0x80) == XCB_EXPOSE)
     {
-        m_renderTextBuffer = m_inputHandler.processEvents(event);
-        m_renderSuggestions = m_inputHandler.getSuggestions();
-        m_index_suggestion = m_inputHandler.getIndexSuggestion();
+        m_ui.invalidate();
+        return reinterpret_cast<xcb_expose_event_t*>(event)->count == 0;
+    }
+
+    return changed;
+}
+
+void Rex::handleCommand(const std::string& command)
+{
+    if (command == "show")
+    {
+        show();
+    }
+}
+
+void Rex::handlePathChanges()
+{
+    PathChanges changes;
+    if (!m_watcher.takeChanges(changes))
+    {
+        return;
+    }
+
+    // The refreshed suggestions arrive like any other search results
+    m_inputHandler.applyPathChanges(changes);
+}
 
-        m_ui.updateUI(m_renderTextBuffer, m_renderSuggestions, m_index_suggestion);
+void Rex::handleSearchResults()
+{
+    if (m_inputHandler.takeSearchResults() && m_visible)
+    {
+        render();
     }
+}
+
+void Rex::render()
+{
+    m_renderTextBuffer = m_inputHandler.getInputText();
+    m_index_suggestion = m_inputHandler.getIndexSuggestion();
+
+    // The rows are drawn straight from the index, which the search worker
+    // must not change meanwhile
+    {
+        std::shared_lock<std::shared_mutex> names = m_inputHandler.lockNames();
+        m_ui.updateUI(m_renderTextBuffer, m_inputHandler.getSuggestions(), m_inputHandler.getNames(), m_index_suggestion);
+    }
+
+    if (m_input_time && !m_inputHandler.searchPending())
+    {
+        LatencyTracer::record(LatencyTracer::Stage::Keystroke, m_input_time, LatencyTracer::now());
+        m_input_time = 0;
+    }
+}
+
+void Rex::show()
+{
+    if (m_visible)
+    {
+        return;
+    }
+
+    // Everything is already warm: one map, and the resulting Expose draws
+    // the single frame.
+    m_visible = true;
+    m_ui.show();
+}
+
+void Rex::hide()
+{
+    m_visible = false;
+    m_ui.hide();
+    m_inputHandler.reset();
+
+    m_renderTextBuffer = {};
+    m_index_suggestion = 0;
+    m_input_time = 0;
 }
\ No newline at end of file
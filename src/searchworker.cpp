@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/searchworker.hpp"
+
+bool SearchWorker::start()
+{
+    m_request_fd = eventfd(0, EFD_CLOEXEC);
+    m_result_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_request_fd < 0 || m_result_fd < 0)
+    {
+        logError(std::string("Failed to create eventfd: ") + strerror(errno));
+        return false;
+    }
+
+    m_latest = m_suggestions.search_generation();
+    m_thread = std::thread(&SearchWorker::run, this);
+    return true;
+}
+
+void SearchWorker::stop()
+{
+    if (m_thread.joinable())
+    {
+        Request request;
+        request.m_kind = Request::Kind::Stop;
+        post(request);
+        m_thread.join();
+    }
+
+    for (int* fd : { &m_request_fd, &m_result_fd })
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+uint64_t SearchWorker::search(std::string_view query, int limit)
+{
+    // Bumping the generation here, not on the worker, is what stops a search
+    // that is still running for an older query.
+    m_latest = m_suggestions.cancel_search();
+
+    // Written into the slot, whose text keeps the capacity it had
+    auto fill = [&](Request& request)
+    {
+        request.m_kind = Request::Kind::Search;
+        request.m_generation = m_latest;
+        request.m_limit = limit;
+        request.m_text.assign(query);
+    };
+
+    while (!m_requests.try_push_in_place(fill))
+    {
+        std::this_thread::yield();
+    }
+    signal(m_request_fd);
+    return m_latest;
+}
+
+void SearchWorker::cancel()
+{
+    m_latest = m_suggestions.cancel_search();
+}
+
+void SearchWorker::applyPathChanges(PathChanges changes)
+{
+    Request request;
+    request.m_kind = Request::Kind::PathChanges;
+    request.m_changes = std::move(changes);
+    post(request);
+}
+
+void SearchWorker::recordLaunch(const std::string& name)
+{
+    Request request;
+    request.m_kind = Request::Kind::Launch;
+    request.m_text = name;
+    post(request);
+}
+
+bool SearchWorker::takeResults(std::vector<uint32_t>& matches)
+{
+    uint64_t count;
+    while (read(m_result_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+    {
+    }
+
+    bool found = false;
+    auto take = [&](Result& result)
+    {
+        if (result.m_generation == m_latest)
+        {
+            matches.assign(result.m_matches.begin(), result.m_matches.end());
+            found = true;
+        }
+    };
+
+    while (m_results.try_pop_in_place(take))
+    {
+    }
+
+    return found;
+}
+
+void SearchWorker::waitForResults(std::vector<uint32_t>& matches)
+{
+    pollfd fd = { m_result_fd, POLLIN, 0 };
+    while (!takeResults(matches))
+    {
+        poll(&fd, 1, -1);
+    }
+}
+
+void SearchWorker::post(Request& request)
+{
+    // Only a worker stuck on 64 requests can fill the queue. Superseded
+    // searches are skipped in no time, so the wait is short.
+    while (!m_requests.try_push(request))
+    {
+        std::this_thread::yield();
+    }
+    signal(m_request_fd);
+}
+
+void SearchWorker::run()
+{
+    bool running = true;
+    auto handleRequest = [&](Request& request)
+    {
+        running = handle(request);
+    };
+
+    while (running)
+    {
+        uint64_t count;
+        if (read(m_request_fd, &count, sizeof(count)) < 0 && errno != EINTR)
+        {
+            logError(std::string("Failed to wait for requests: ") + strerror(errno));
+            return;
+        }
+
+        while (running && m_requests.try_pop_in_place(handleRequest))
+        {
+        }
+    }
+}
+
+bool SearchWorker::handle(Request& request)
+{
+    switch (request.m_kind)
+    {
+        case Request::Kind::Stop:
+            return false;
+        case Request::Kind::PathChanges:
+            m_suggestions.apply_path_changes(request.m_changes);
+            request.m_changes.clear();
+            break;
+        case Request::Kind::Launch:
+            m_suggestions.record_launch(request.m_text);
+            break;
+        case Request::Kind::Search:
+        {
+            size_t limit = static_cast<size_t>(std::max(request.m_limit, 0));
+            if (m_matches.size() < limit)
+            {
+                m_matches.resize(limit);
+            }
+
+            // Fails straight away for a search superseded while queued
+            size_t count = 0;
+            if (!m_suggestions.get_best_matches(request.m_text, request.m_generation, m_matches.data(), limit, count))
+            {
+                break;
+            }
+
+            auto fill = [&](Result& result)
+            {
+                result.m_generation = request.m_generation;
+                result.m_matches.assign(m_matches.begin(), m_matches.begin() + count);
+            };
+
+            // Every published result was current when it was pushed, and the
+            // event loop drains them all on each wakeup, so this only waits
+            // if the loop is busy with a burst of them.
+            while (!m_results.try_push_in_place(fill))
+            {
+                std::this_thread::yield();
+            }
+            signal(m_result_fd);
+            break;
+        }
+    }
+    return true;
+}
+
+void SearchWorker::signal(int fd)
+{
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+void SearchWorker::logError(const std::string& error_message)
+{
+    std::cerr << "SearchWorker Error: " << error_message << std::endl;
+}
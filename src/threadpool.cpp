@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024, shAdE424
+ * All rights reserved.
+ *
+ * This file is part of Rex, licensed under the BSD 3-Clause License.
+ * See the LICENSE file at the root of this repository for full details.
+ */
+
+#include "../include/threadpool.hpp"
+
+ThreadPool::ThreadPool(size_t workers) : m_stopping(false), m_job(0), m_active(0), m_task(nullptr), m_count(0), m_next(0)
+{
+    for (size_t i = 0; i < workers; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (m_workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_active = m_workers.size();
+        ++m_job;
+    }
+    m_wake.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+}
+
+size_t ThreadPool::size() const
+{
+    return m_workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+    uint64_t seen_job = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen_job] { return m_stopping || m_job != seen_job; });
+            if (m_stopping)
+            {
+                return;
+            }
+            seen_job = m_job;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    // Tasks are claimed one at a time, so a slow directory or chunk never
+    // holds up the others.
+    size_t i;
+    while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count)
+    {
+        (*m_task)(i);
+    }
+}
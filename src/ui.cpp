@@ -8,7 +8,57 @@
 
 #include "../include/ui.hpp"
 
-void UI::init(xcb_connection_t* connection, xcb_window_t window_id)
+void UI::prefetch(xcb_connection_t* connection)
+{
+    m_connection = connection;
+
+    requestAtoms();
+    xcb_prefetch_extension_data(m_connection, &xcb_shm_id);
+
+    // Get the requests on the wire before the caller goes off to do other work
+    xcb_flush(m_connection);
+}
+
+void UI::requestAtoms()
+{
+    if (m_atoms_requested)
+    {
+        return;
+    }
+
+    static constexpr const char* kAtomNames[kAtomCount] =
+    {
+        "_NET_WM_WINDOW_TYPE",
+        "_NET_WM_WINDOW_TYPE_UTILITY",
+        "_NET_ACTIVE_WINDOW",
+        "_NET_WM_STATE",
+        "_NET_WM_STATE_SKIP_TASKBAR",
+        "_NET_WM_STATE_SKIP_PAGER",
+        "_NET_WM_STATE_ABOVE",
+        "_NET_WM_WINDOW_OPACITY",
+        "_MOTIF_WM_HINTS"
+    };
+
+    for (size_t i = 0; i < kAtomCount; ++i)
+    {
+        m_atom_cookies[i] = xcb_intern_atom(m_connection, 0, strlen(kAtomNames[i]), kAtomNames[i]);
+    }
+
+    m_atoms_requested = true;
+}
+
+void UI::collectAtoms()
+{
+    // The replies arrive in request order, so only the first wait can block
+    for (size_t i = 0; i < kAtomCount; ++i)
+    {
+        xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(m_connection, m_atom_cookies[i], nullptr);
+        m_atoms[i] = reply ? reply->atom : static_cast<xcb_atom_t>(XCB_ATOM_NONE);
+        free(reply);
+    }
+}
+
+void UI::init(xcb_connection_t* connection, xcb_window_t window_id, bool mapped)
 {
     if (xcb_connection_has_error(connection))
     {
@@ -26,7 +76,7 @@ void UI::init(xcb_connection_t* connection, xcb_window_t window_id)
     m_x = (m_screen->width_in_pixels - m_window_width) / 4.3;
     m_y = (m_screen->height_in_pixels - m_window_height) / 2;
 
-    createWindow();
+    createWindow(mapped);
 
     xcb_visualtype_t* visual = getVisualType(m_screen);
     if (!visual) 
@@ -34,7 +84,19 @@ void UI::init(xcb_connection_t* connection, xcb_window_t window_id)
         throw std::runtime_error("Failed to get XCB visual type.");
     }
 
-    m_cairoSurface = cairo_xcb_surface_create(m_connection, m_window_id, visual, m_window_width, m_window_height);
+    // Rasterize offscreen and present finished frames when the pixel format
+    // allows it; otherwise every Cairo operation goes to the window itself.
+    m_buffered = m_frameBuffer.init(m_connection, m_window_id, m_screen, m_window_width, m_window_height);
+    if (m_buffered)
+    {
+        m_cairoSurface = cairo_image_surface_create_for_data(m_frameBuffer.data(), CAIRO_FORMAT_RGB24,
+                                                             m_window_width, m_window_height, m_frameBuffer.stride());
+    }
+    else
+    {
+        m_cairoSurface = cairo_xcb_surface_create(m_connection, m_window_id, visual, m_window_width, m_window_height);
+    }
+
     if (!m_cairoSurface) 
     {
         throw std::runtime_error("Failed to create Cairo surface.");
@@ -46,15 +108,36 @@ void UI::init(xcb_connection_t* connection, xcb_window_t window_id)
         throw std::runtime_error("Failed to create Cairo context.");
     }
 
-    m_pangoLayout = pango_cairo_create_layout(m_cairoContext);
-    if (!m_pangoLayout) 
     {
-        throw std::runtime_error("Failed to create Pango layout.");
+        LatencyTracer::Scope trace(LatencyTracer::Stage::FontInit);
+        setFont(m_font);
+    }
+    createSprites();
+}
+
+void UI::initHeadless(uint16_t width, uint16_t height)
+{
+    m_connection = nullptr;
+    m_window_width = width;
+    m_window_height = height;
+
+    m_cairoSurface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, m_window_width, m_window_height);
+    if (cairo_surface_status(m_cairoSurface) != CAIRO_STATUS_SUCCESS) 
+    {
+        throw std::runtime_error("Failed to create Cairo surface.");
     }
+
+    m_cairoContext = cairo_create(m_cairoSurface);
+    if (!m_cairoContext) 
+    {
+        throw std::runtime_error("Failed to create Cairo context.");
+    }
+
     setFont(m_font);
+    createSprites();
 }
 
-void UI::createWindow() 
+void UI::createWindow(bool mapped) 
 {
     uint32_t mask = XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_COLORMAP;
     uint32_t values[] = 
@@ -77,28 +160,19 @@ void UI::createWindow()
         mask, values
     );
 
-    auto intern_atom = [this](const char* atom_name) 
-    {
-        xcb_intern_atom_cookie_t cookie = xcb_intern_atom(m_connection, 0, strlen(atom_name), atom_name);
-        xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(m_connection, cookie, nullptr);
-        if (reply) 
-        {
-            xcb_atom_t atom = reply->atom;
-            free(reply);
-            return atom;
-        }
-        return static_cast<xcb_atom_t>(XCB_ATOM_NONE);
-    };
+    // Normally already requested by prefetch(); only the replies are left
+    requestAtoms();
+    collectAtoms();
 
-    xcb_atom_t net_wm_window_type = intern_atom("_NET_WM_WINDOW_TYPE");
-    xcb_atom_t net_wm_window_type_utility = intern_atom("_NET_WM_WINDOW_TYPE_UTILITY");
-    xcb_atom_t net_active_window = intern_atom("_NET_ACTIVE_WINDOW");
-    xcb_atom_t net_wm_state = intern_atom("_NET_WM_STATE");
-    xcb_atom_t net_wm_state_skip_taskbar = intern_atom("_NET_WM_STATE_SKIP_TASKBAR");
-    xcb_atom_t net_wm_state_skip_pager = intern_atom("_NET_WM_STATE_SKIP_PAGER");
-    xcb_atom_t net_wm_state_above = intern_atom("_NET_WM_STATE_ABOVE");
-    xcb_atom_t net_wm_window_opacity = intern_atom("_NET_WM_WINDOW_OPACITY");
-    xcb_atom_t motif_hints = intern_atom("_MOTIF_WM_HINTS");
+    xcb_atom_t net_wm_window_type = m_atoms[kNetWmWindowType];
+    xcb_atom_t net_wm_window_type_utility = m_atoms[kNetWmWindowTypeUtility];
+    m_net_active_window = m_atoms[kNetActiveWindow];
+    xcb_atom_t net_wm_state = m_atoms[kNetWmState];
+    xcb_atom_t net_wm_state_skip_taskbar = m_atoms[kNetWmStateSkipTaskbar];
+    xcb_atom_t net_wm_state_skip_pager = m_atoms[kNetWmStateSkipPager];
+    xcb_atom_t net_wm_state_above = m_atoms[kNetWmStateAbove];
+    xcb_atom_t net_wm_window_opacity = m_atoms[kNetWmWindowOpacity];
+    xcb_atom_t motif_hints = m_atoms[kMotifWmHints];
 
     // Set window type to utility
     if (net_wm_window_type != XCB_ATOM_NONE && net_wm_window_type_utility != XCB_ATOM_NONE) 
@@ -142,14 +216,26 @@ void UI::createWindow()
         xcb_change_property(m_connection, XCB_PROP_MODE_REPLACE, m_window_id, motif_hints, motif_hints, 32, sizeof(MotifHints) / 4, &hints);
     }
 
+    if (mapped)
+    {
+        show();
+    }
+    else
+    {
+        xcb_flush(m_connection);
+    }
+}
+
+void UI::show()
+{
     xcb_map_window(m_connection, m_window_id);
 
-    if (net_active_window != XCB_ATOM_NONE) 
+    if (m_net_active_window != XCB_ATOM_NONE) 
     {
         xcb_client_message_event_t event = {};
         event.response_type = XCB_CLIENT_MESSAGE;
         event.window = m_window_id;
-        event.type = net_active_window;
+        event.type = m_net_active_window;
         event.format = 32;
         event.data.data32[0] = 1; // Source indication (1 = application)
         event.data.data32[1] = XCB_CURRENT_TIME;
@@ -174,46 +260,40 @@ void UI::createWindow()
     xcb_flush(m_connection);
 }
 
-void UI::drawUI(const std::string& query, const std::vector<std::string>& suggestions, size_t highlightedIndex)
+void UI::hide()
 {
-    clearUI();
-    drawSearchBar(query);
-    drawSuggestions(suggestions, highlightedIndex);
-    cairo_surface_flush(m_cairoSurface);
+    xcb_unmap_window(m_connection, m_window_id);
     xcb_flush(m_connection);
 }
 
-void UI::drawSearchBar(const std::string& query)
+void UI::drawUI(std::string_view query, const std::vector<uint32_t>& suggestions, const CandidatePool& names, size_t highlightedIndex)
 {
-    const int padding = 5;  // Padding inside the rectangle
-    const int rectHeight = 30;  // Height of the rectangle
-    const int rectWidth = 10 + 45; // Adjust width based on the query length (a rough estimate)
-    const int cornerRadius = 5;  // Rounded corners radius
-    const float alpha = 0.5f;  // Transparency for the rectangle
-
-    cairo_set_source_rgba(m_cairoContext, 0.5, 0.7, 1.0, alpha); // Light blue with transparency
-
-    cairo_new_path(m_cairoContext);
-    cairo_move_to(m_cairoContext, padding + cornerRadius, 0); 
-
-    cairo_line_to(m_cairoContext, rectWidth - cornerRadius * 2, 0);  // Top line
-    cairo_arc(m_cairoContext, rectWidth - cornerRadius, 0 + cornerRadius, cornerRadius, -M_PI_2, 0);  // Top-right corner
-
-    cairo_line_to(m_cairoContext, rectWidth, 0 + rectHeight - cornerRadius);  // Right side
-    cairo_arc(m_cairoContext, rectWidth - cornerRadius, 0 + rectHeight - cornerRadius, cornerRadius, 0, M_PI_2);  // Bottom-right corner
+    m_frameBuffer.waitIdle();
 
-    cairo_line_to(m_cairoContext, padding + cornerRadius, 0 + rectHeight);  // Bottom side
-    cairo_arc(m_cairoContext, padding + cornerRadius, 0 + rectHeight - cornerRadius, cornerRadius, M_PI_2, M_PI);  // Bottom-left corner
+    clearUI();
+    drawSearchBar(query);
+    drawSuggestions(suggestions, names, highlightedIndex);
+    present(0, m_window_height);
+    m_present_all = false;
+
+    m_frame.m_query.assign(query);
+    m_frame.m_suggestions = suggestions;
+    m_frame.m_highlighted = static_cast<ssize_t>(highlightedIndex);
+    m_frame.m_valid = true;
+}
 
-    cairo_line_to(m_cairoContext, padding, 0 + cornerRadius);  // Left side
-    cairo_arc(m_cairoContext, padding + cornerRadius, 0 + cornerRadius, cornerRadius, M_PI, -M_PI_2);  // Top-left corner
+void UI::drawSearchBar(std::string_view query)
+{
+    LatencyTracer::Scope trace(LatencyTracer::Stage::DrawSearchBar);
 
-    cairo_close_path(m_cairoContext);
-    cairo_fill(m_cairoContext); 
+    cairo_set_source_surface(m_cairoContext, m_searchBarSprite, 0, 0);
+    cairo_paint(m_cairoContext);
 
-    drawText(m_cairoContext, 5, 3, "Search: " + query, false);
+    m_searchText.assign("Search: ");
+    m_searchText.append(query);
+    drawText(m_cairoContext, 5, 3, m_searchText, false);
 
-    // Draw black line under the search prompt
+    // Draw black line under the search prompt, over the text as it always was
     cairo_set_source_rgb(m_cairoContext, 0, 0, 0);
     cairo_set_line_width(m_cairoContext, 2);
     cairo_move_to(m_cairoContext, 5, 30); 
@@ -221,70 +301,133 @@ void UI::drawSearchBar(const std::string& query)
     cairo_stroke(m_cairoContext);
 }
 
-void UI::drawSuggestions(const std::vector<std::string>& suggestions, size_t highlightedIndex)
+void UI::drawSuggestions(const std::vector<uint32_t>& suggestions, const CandidatePool& names, size_t highlightedIndex)
 {
+    LatencyTracer::Scope trace(LatencyTracer::Stage::DrawSuggestions);
+
     ++m_draw_suggestions_count;
-    int y = 40;
+
+    for (size_t i = 0; i < suggestions.size(); ++i) 
+    {
+        drawSuggestion(i, names.get(suggestions[i]), highlightedIndex == i);
+    }
+}
+
+void UI::drawSuggestion(size_t index, std::string_view suggestion, bool highlighted)
+{
+    int y = suggestionTop(index);
     const int padding = 10;  // Padding around text inside the rectangle
-    const int rectHeight = 40; // Height for each rectangle
-    const int rectWidth = m_window_width - 1.2 * padding; // Width for each rectangle with padding
-    const float alpha = 0.3f; // Transparency level for the rectangle (range 0.0 to 1.0)
     const int cornerRadius = 6; // Radius for rounded corners
-    const int verticalSpacing = 5; // Vertical spacing between rectangles
 
-    for (size_t i = 0; i < suggestions.size(); ++i) 
+    cairo_set_source_surface(m_cairoContext, m_rowSprite, 0, y);
+    cairo_paint(m_cairoContext);
+
+    // Draw the suggestion text on top of the rectangle
+    drawText(m_cairoContext, padding + cornerRadius, y + padding, suggestion, highlighted);
+}
+
+void UI::createSprites()
+{
+    destroySprites();
+
+    // Render-target compatible: server-side pixmaps when drawing to the
+    // window directly, image surfaces when drawing offscreen.
+    m_searchBarSprite = cairo_surface_create_similar(m_cairoSurface, CAIRO_CONTENT_COLOR_ALPHA, m_window_width, kSuggestionsTop);
+    m_rowSprite = cairo_surface_create_similar(m_cairoSurface, CAIRO_CONTENT_COLOR_ALPHA, m_window_width, kSuggestionHeight);
+
+    cairo_t* cr = cairo_create(m_searchBarSprite);
+    {
+        const int padding = 5;  // Padding inside the rectangle
+        const int rectHeight = 30;  // Height of the rectangle
+        const int rectWidth = 10 + 45; // Adjust width based on the query length (a rough estimate)
+        const int cornerRadius = 5;  // Rounded corners radius
+        const float alpha = 0.5f;  // Transparency for the rectangle
+
+        cairo_set_source_rgba(cr, 0.5, 0.7, 1.0, alpha); // Light blue with transparency
+
+        cairo_new_path(cr);
+        cairo_move_to(cr, padding + cornerRadius, 0); 
+
+        cairo_line_to(cr, rectWidth - cornerRadius * 2, 0);  // Top line
+        cairo_arc(cr, rectWidth - cornerRadius, 0 + cornerRadius, cornerRadius, -M_PI_2, 0);  // Top-right corner
+
+        cairo_line_to(cr, rectWidth, 0 + rectHeight - cornerRadius);  // Right side
+        cairo_arc(cr, rectWidth - cornerRadius, 0 + rectHeight - cornerRadius, cornerRadius, 0, M_PI_2);  // Bottom-right corner
+
+        cairo_line_to(cr, padding + cornerRadius, 0 + rectHeight);  // Bottom side
+        cairo_arc(cr, padding + cornerRadius, 0 + rectHeight - cornerRadius, cornerRadius, M_PI_2, M_PI);  // Bottom-left corner
+
+        cairo_line_to(cr, padding, 0 + cornerRadius);  // Left side
+        cairo_arc(cr, padding + cornerRadius, 0 + cornerRadius, cornerRadius, M_PI, -M_PI_2);  // Top-left corner
+
+        cairo_close_path(cr);
+        cairo_fill(cr); 
+    }
+    cairo_destroy(cr);
+
+    cr = cairo_create(m_rowSprite);
     {
-        cairo_set_source_rgba(m_cairoContext, 0.5, 0.7, 1.0, alpha); // Light blue with higher transparency
+        int y = 0;
+        const int padding = 10;  // Padding around text inside the rectangle
+        const int rectHeight = kSuggestionHeight; // Height for each rectangle
+        const int rectWidth = m_window_width - 1.2 * padding; // Width for each rectangle with padding
+        const float alpha = 0.3f; // Transparency level for the rectangle (range 0.0 to 1.0)
+        const int cornerRadius = 6; // Radius for rounded corners
+
+        cairo_set_source_rgba(cr, 0.5, 0.7, 1.0, alpha); // Light blue with higher transparency
         
         // Set rounded corners for the rectangle
-        cairo_new_path(m_cairoContext);  // Start a new path for the rectangle
-        cairo_move_to(m_cairoContext, padding + cornerRadius, y);  // Move to the start position, adjusted for corner radius
+        cairo_new_path(cr);  // Start a new path for the rectangle
+        cairo_move_to(cr, padding + cornerRadius, y);  // Move to the start position, adjusted for corner radius
 
         // Draw the top line
-        cairo_line_to(m_cairoContext, rectWidth - cornerRadius * 2, y);  // Top line
-        cairo_arc(m_cairoContext, rectWidth - cornerRadius, y + cornerRadius, cornerRadius, -M_PI_2, 0);  // Top-right corner
+        cairo_line_to(cr, rectWidth - cornerRadius * 2, y);  // Top line
+        cairo_arc(cr, rectWidth - cornerRadius, y + cornerRadius, cornerRadius, -M_PI_2, 0);  // Top-right corner
 
         // Draw the right line
-        cairo_line_to(m_cairoContext, rectWidth, y + rectHeight - cornerRadius);  // Right side
-        cairo_arc(m_cairoContext, rectWidth - cornerRadius, y + rectHeight - cornerRadius, cornerRadius, 0, M_PI_2);  // Bottom-right corner
+        cairo_line_to(cr, rectWidth, y + rectHeight - cornerRadius);  // Right side
+        cairo_arc(cr, rectWidth - cornerRadius, y + rectHeight - cornerRadius, cornerRadius, 0, M_PI_2);  // Bottom-right corner
 
         // Draw the bottom line
-        cairo_line_to(m_cairoContext, padding + cornerRadius, y + rectHeight);  // Bottom side
-        cairo_arc(m_cairoContext, padding + cornerRadius, y + rectHeight - cornerRadius, cornerRadius, M_PI_2, M_PI);  // Bottom-left corner
+        cairo_line_to(cr, padding + cornerRadius, y + rectHeight);  // Bottom side
+        cairo_arc(cr, padding + cornerRadius, y + rectHeight - cornerRadius, cornerRadius, M_PI_2, M_PI);  // Bottom-left corner
 
         // Draw the left line
-        cairo_line_to(m_cairoContext, padding, y + cornerRadius);  // Left side
-        cairo_arc(m_cairoContext, padding + cornerRadius, y + cornerRadius, cornerRadius, M_PI, -M_PI_2);  // Top-left corner
+        cairo_line_to(cr, padding, y + cornerRadius);  // Left side
+        cairo_arc(cr, padding + cornerRadius, y + cornerRadius, cornerRadius, M_PI, -M_PI_2);  // Top-left corner
 
-        cairo_close_path(m_cairoContext); 
-        cairo_fill(m_cairoContext); 
+        cairo_close_path(cr); 
+        cairo_fill(cr); 
+    }
+    cairo_destroy(cr);
+}
 
-        if (highlightedIndex == i) 
-        {
-            cairo_set_source_rgb(m_cairoContext, (m_highlightColor >> 16 & 0xFF) / 255.0, 
-                                 (m_highlightColor >> 8 & 0xFF) / 255.0, 
-                                 (m_highlightColor & 0xFF) / 255.0);  // Highlight color
-        } 
-        else 
+void UI::destroySprites()
+{
+    for (cairo_surface_t** sprite : { &m_searchBarSprite, &m_rowSprite })
+    {
+        if (*sprite)
         {
-            cairo_set_source_rgb(m_cairoContext, (m_textColor >> 16 & 0xFF) / 255.0, 
-                                 (m_textColor >> 8 & 0xFF) / 255.0, 
-                                 (m_textColor & 0xFF) / 255.0);  // Regular text color
+            cairo_surface_destroy(*sprite);
+            *sprite = nullptr;
         }
-
-        // Draw the suggestion text on top of the rectangle
-        drawText(m_cairoContext, padding + cornerRadius, y + padding, suggestions[i], highlightedIndex == i);
-        
-        y += rectHeight + verticalSpacing;  // Move to the next suggestion (with vertical spacing)
     }
 }
 
+int UI::suggestionTop(size_t index) const
+{
+    return kSuggestionsTop + static_cast<int>(index) * (kSuggestionHeight + kSuggestionSpacing);
+}
+
 void UI::setFont(const std::string& fontDescription)
 {
     m_font = fontDescription;
-    PangoFontDescription* font_desc = pango_font_description_from_string(m_font.c_str());
-    pango_layout_set_font_description(m_pangoLayout, font_desc);
-    pango_font_description_free(font_desc);
+    m_layoutCache.setFont(m_font);
+}
+
+const LayoutCache& UI::layoutCache() const
+{
+    return m_layoutCache;
 }
 
 void UI::setSourceColor(cairo_t* cr, uint32_t color) 
@@ -296,7 +439,7 @@ void UI::setSourceColor(cairo_t* cr, uint32_t color)
     );
 }
 
-void UI::drawText(cairo_t* cr, int x, int y, const std::string& text, bool highlighted)
+void UI::drawText(cairo_t* cr, int x, int y, std::string_view text, bool highlighted)
 {
     if (highlighted) 
     {
@@ -310,10 +453,10 @@ void UI::drawText(cairo_t* cr, int x, int y, const std::string& text, bool highl
                              (m_textColor >> 8 & 0xFF) / 255.0, 
                              (m_textColor & 0xFF) / 255.0);
     }
+    // Rows that did not change reuse their shaped layout. The context's
+    // transformation never changes, so cached layouts stay valid for it.
     cairo_move_to(cr, x, y);
-    pango_layout_set_text(m_pangoLayout, text.c_str(), -1);
-    pango_cairo_update_layout(cr, m_pangoLayout);
-    pango_cairo_show_layout(cr, m_pangoLayout);
+    pango_cairo_show_layout(cr, m_layoutCache.get(cr, text));
 }
 
 xcb_visualtype_t* UI::getVisualType(xcb_screen_t* screen) 
@@ -334,15 +477,132 @@ xcb_visualtype_t* UI::getVisualType(xcb_screen_t* screen)
     return nullptr;
 }
 
-void UI::updateUI(std::string_view typedText, std::vector<std::string> suggestions, ssize_t highlightedIndex)
+void UI::updateUI(std::string_view typedText, const std::vector<uint32_t>& suggestions, const CandidatePool& names, ssize_t highlightedIndex)
 {
-    clearUI();
-    drawSearchBar(std::string(typedText));
+    if (!m_frame.m_valid)
+    {
+        drawUI(typedText, suggestions, names, highlightedIndex);
+        return;
+    }
+
+    // Compare against what is on screen and repaint only what differs.
+    // Moving the highlight touches two rows; typing touches the search bar
+    // and the rows whose text changed.
+    int damage_top = m_window_height;
+    int damage_bottom = 0;
+    auto damage = [&](int y, int height)
+    {
+        damage_top = std::min(damage_top, y);
+        damage_bottom = std::max(damage_bottom, y + height);
+    };
+
+    m_frameBuffer.waitIdle();
+
+    if (typedText != m_frame.m_query)
+    {
+        repaintRegion(0, kSuggestionsTop, [&]
+        {
+            drawSearchBar(typedText);
+        });
+        m_frame.m_query.assign(typedText);
+        damage(0, kSuggestionsTop);
+    }
+
+    // Timed like drawSuggestions() in a full frame
+    uint64_t rows_start = LatencyTracer::enabled() ? LatencyTracer::now() : 0;
+    size_t rows = std::max(suggestions.size(), m_frame.m_suggestions.size());
+    for (size_t i = 0; i < rows; ++i)
+    {
+        bool was_shown = i < m_frame.m_suggestions.size();
+        bool is_shown = i < suggestions.size();
+        bool was_highlighted = m_frame.m_highlighted == static_cast<ssize_t>(i);
+        bool is_highlighted = highlightedIndex == static_cast<ssize_t>(i);
+
+        if (was_shown == is_shown && (!is_shown || (suggestions[i] == m_frame.m_suggestions[i] && was_highlighted == is_highlighted)))
+        {
+            continue;
+        }
+
+        // The row and the gap below it; a vanished row is just cleared.
+        // Passed by reference, as a std::function of it would allocate.
+        auto drawRow = [&]
+        {
+            if (is_shown)
+            {
+                drawSuggestion(i, names.get(suggestions[i]), is_highlighted);
+            }
+        };
+        repaintRegion(suggestionTop(i), kSuggestionHeight + kSuggestionSpacing, std::cref(drawRow));
+        damage(suggestionTop(i), kSuggestionHeight + kSuggestionSpacing);
+    }
+
+    if (rows_start)
+    {
+        LatencyTracer::record(LatencyTracer::Stage::DrawSuggestions, rows_start, LatencyTracer::now());
+    }
+
+    m_frame.m_suggestions = suggestions;
+    m_frame.m_highlighted = highlightedIndex;
+
+    // One band from the topmost to the bottommost damaged row
+    if (m_present_all)
+    {
+        damage(0, m_window_height);
+        m_present_all = false;
+    }
+
+    if (damage_top < damage_bottom)
+    {
+        present(damage_top, damage_bottom - damage_top);
+    }
+}
+
+void UI::invalidate()
+{
+    // An offscreen frame is still intact and only has to be shown again
+    if (m_buffered)
+    {
+        m_present_all = true;
+    }
+    else
+    {
+        m_frame.m_valid = false;
+    }
+}
+
+bool UI::handleEvent(const xcb_generic_event_t* event)
+{
+    return m_buffered && m_frameBuffer.handleEvent(event);
+}
+
+void UI::present(int y, int height)
+{
+    LatencyTracer::Scope trace(LatencyTracer::Stage::Present);
 
-    drawSuggestions(suggestions, highlightedIndex);
-    
     cairo_surface_flush(m_cairoSurface);
-    xcb_flush(m_connection);
+
+    if (m_buffered)
+    {
+        m_frameBuffer.present(y, height);
+    }
+    else if (m_connection)
+    {
+        xcb_flush(m_connection);
+    }
+}
+
+void UI::repaintRegion(int y, int height, const std::function<void()>& draw)
+{
+    // Clipped, the background paint and everything drawn after it only
+    // produce X requests for the damaged band.
+    cairo_save(m_cairoContext);
+    cairo_rectangle(m_cairoContext, 0, y, m_window_width, height);
+    cairo_clip(m_cairoContext);
+
+    clearUI();
+    draw();
+
+    cairo_restore(m_cairoContext);
 }
 
 void UI::clearUI()